@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+#include "common.h"
+#include "vector.h"
+#include "vector_view.h"
+#include "pair.h"
+#include "sort.h"
+#include "radix_sort.h"
+
+
+namespace algo {
+
+/// a key and the position it came from: the key sorts move these
+/// instead of whole records and apply the order to the records once
+template<typename K>
+using key_index = pair<K, uint32_t>;
+
+template<typename T>
+vector<key_index<view_value_t<T>>> key_indices(vector_view<T> keys) {
+	assert(keys.size() <= std::numeric_limits<uint32_t>::max());
+	vector<key_index<view_value_t<T>>> res;
+	res.reserve(keys.size());
+	for (size_t i = 0; i < keys.size(); ++i) {
+		res.push_back(key_index<view_value_t<T>>(keys[i], static_cast<uint32_t>(i)));
+	}
+	return res;
+}
+
+template<typename K>
+vector<uint32_t> indices(const vector<key_index<K>>& items) {
+	vector<uint32_t> res(items.size(), 0);
+	for (size_t i = 0; i < items.size(); ++i) {
+		res[i] = items[i].second;
+	}
+	return res;
+}
+
+/// writes the sorted keys back and gathers the values in their order
+template<typename K, typename V>
+void apply_key_order(const vector<key_index<K>>& items, vector_view<K> keys, vector_view<V> values) {
+	assert(keys.size() == items.size() && values.size() == items.size());
+	vector<V> tmp;
+	tmp.reserve(items.size());
+	for (size_t i = 0; i < items.size(); ++i) {
+		keys[i] = items[i].first;
+		tmp.push_back(std::move(values[items[i].second]));
+	}
+	for (size_t i = 0; i < items.size(); ++i) {
+		values[i] = std::move(tmp[i]);
+	}
+}
+
+template<typename K>
+void stable_sort_key_indices(vector<key_index<K>>& items) {
+	vector<key_index<K>> buf(items.size(), key_index<K>());
+	merge_sort(items.view(), buf.view());
+}
+
+/// the permutation that sorts keys, keys[res[0]] <= keys[res[1]] <= ...
+/// it is found by quick_sort, so equal keys come in any order.
+template<typename T>
+vector<uint32_t> argsort(vector_view<T> keys) {
+	auto items = key_indices(keys);
+	quick_sort(items);
+	return indices(items);
+}
+
+template<typename T>
+vector<uint32_t> argsort(const vector<T>& keys) {
+	return argsort(keys.view());
+}
+
+/// argsort by merge_sort, equal keys keep their order
+template<typename T>
+vector<uint32_t> stable_argsort(vector_view<T> keys) {
+	auto items = key_indices(keys);
+	stable_sort_key_indices(items);
+	return indices(items);
+}
+
+template<typename T>
+vector<uint32_t> stable_argsort(const vector<T>& keys) {
+	return stable_argsort(keys.view());
+}
+
+/// argsort by parallel_radix_sort, for keys with a radix_key. equal keys keep
+/// their order. the passes move only keys and 32 bit indices.
+template<typename T>
+vector<uint32_t> radix_argsort(vector_view<T> keys, size_t threads = hardware_threads()) {
+	auto items = key_indices(keys);
+	parallel_radix_sort(items.view(), threads);
+	return indices(items);
+}
+
+template<typename T>
+vector<uint32_t> radix_argsort(const vector<T>& keys, size_t threads = hardware_threads()) {
+	return radix_argsort(keys.view(), threads);
+}
+
+/// sorts keys and moves values[i] along with keys[i]. the sort moves keys and
+/// indices, every value is moved twice in the end, so large values are cheap.
+/// by quick_sort, so values of equal keys come in any order.
+template<typename K, typename V>
+void sort_by_key(vector_view<K> keys, vector_view<V> values) {
+	auto items = key_indices(keys);
+	quick_sort(items);
+	apply_key_order(items, keys, values);
+}
+
+template<typename K, typename V>
+void sort_by_key(vector<K>& keys, vector<V>& values) {
+	sort_by_key(keys.view(), values.view());
+}
+
+/// sort_by_key by merge_sort, values of equal keys keep their order
+template<typename K, typename V>
+void stable_sort_by_key(vector_view<K> keys, vector_view<V> values) {
+	auto items = key_indices(keys);
+	stable_sort_key_indices(items);
+	apply_key_order(items, keys, values);
+}
+
+template<typename K, typename V>
+void stable_sort_by_key(vector<K>& keys, vector<V>& values) {
+	stable_sort_by_key(keys.view(), values.view());
+}
+
+/// sort_by_key by parallel_radix_sort, for keys with a radix_key.
+/// values of equal keys keep their order
+template<typename K, typename V>
+void radix_sort_by_key(vector_view<K> keys, vector_view<V> values, size_t threads = hardware_threads()) {
+	auto items = key_indices(keys);
+	parallel_radix_sort(items.view(), threads);
+	apply_key_order(items, keys, values);
+}
+
+template<typename K, typename V>
+void radix_sort_by_key(vector<K>& keys, vector<V>& values, size_t threads = hardware_threads()) {
+	radix_sort_by_key(keys.view(), values.view(), threads);
+}
+
+}
@@ -0,0 +1,295 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#include "common.h"
+#include "vector.h"
+#include "vector_view.h"
+#include "parallel.h"
+#include "sort.h"
+#include "sample_sort.h"
+#include "radix_sort.h"
+#include "simd_sort.h"
+
+
+namespace algo {
+
+/// the sorts auto_sort picks from
+enum class sort_algorithm {
+	insertion,
+	natural_merge,
+	counting,
+	radix,
+	intro,
+	three_way_quick,
+	simd_quick,
+	parallel_sample,
+};
+
+inline const char * sort_algorithm_name(sort_algorithm a) {
+	switch (a) {
+	case sort_algorithm::insertion:
+		return "insertion_sort";
+	case sort_algorithm::natural_merge:
+		return "natural_merge_sort";
+	case sort_algorithm::counting:
+		return "counting_sort";
+	case sort_algorithm::radix:
+		return "parallel_radix_sort";
+	case sort_algorithm::intro:
+		return "intro_sort";
+	case sort_algorithm::three_way_quick:
+		return "three_way_quick_sort";
+	case sort_algorithm::simd_quick:
+		return "simd_quick_sort";
+	case sort_algorithm::parallel_sample:
+		return "parallel_sample_sort";
+	}
+	return "?";
+}
+
+/// what auto_sort found out about its input
+struct sort_profile {
+	size_t size{0};
+	/// neighbors compared in windows spread over the input and how many were descending
+	size_t pairs{0};
+	size_t descents{0};
+	/// the runs natural_merge_sort would find, estimated from the descents
+	size_t runs{0};
+	/// elements sampled and the distinct values among them
+	size_t samples{0};
+	size_t distinct{0};
+	/// max - min + 1 of integer keys, 0 if unknown or too large. of the sample,
+	/// of the whole input if counting_sort was considered
+	uint64_t range{0};
+};
+
+/// the thresholds of auto_sort, to be tuned with the plans it returns
+struct auto_sort_limits {
+	/// up to this size insertion sort
+	size_t insertion{32};
+	/// from this size on the sort runs on several threads
+	size_t parallel{1 << 18};
+	/// natural_merge_sort if runs of this length or longer are expected
+	size_t run_length{64};
+	/// counting_sort if the keys span at most this many values and not more than there are keys
+	size_t counting_range{1 << 16};
+	/// radix sort from this size on, if T has a radix_key
+	size_t radix{1 << 12};
+	/// three_way_quick_sort if there are at most this many distinct keys among the samples
+	size_t three_way_distinct{64};
+};
+
+/// what auto_sort does and why
+struct sort_plan {
+	sort_algorithm algorithm{sort_algorithm::insertion};
+	size_t threads{1};
+	sort_profile profile{};
+};
+
+/// the input is sampled in this many windows of this many neighbors and by this many elements
+const size_t sort_profile_windows = 64;
+const size_t sort_profile_window = 8;
+const size_t sort_profile_samples = 256;
+
+/// integers other than bool, the keys counting_sort takes
+template<typename T>
+using is_counting_key = std::integral_constant<bool, std::is_integral<T>::value && !std::is_same<T, bool>::value>;
+
+template<typename T>
+uint64_t key_range(const T& min, const T& max, std::true_type) {
+	// modulo 2^64, so the full range of 64 bit keys is 0, unknown
+	return static_cast<uint64_t>(max) - static_cast<uint64_t>(min) + 1;
+}
+
+template<typename T>
+uint64_t key_range(const T&, const T&, std::false_type) {
+	return 0;
+}
+
+template<typename T>
+uint64_t key_range(vector_view<T> v) {
+	auto min = v[0];
+	auto max = v[0];
+	for (size_t i = 1; i < v.size(); ++i) {
+		min = std::min(min, v[i]);
+		max = std::max(max, v[i]);
+	}
+	return key_range(min, max, is_counting_key<T>());
+}
+
+/// looks at O(1) elements of v, which has at least 2
+template<typename T>
+sort_profile profile_sort_input(vector_view<T> v) {
+	const auto n = v.size();
+	assert(n >= 2);
+	sort_profile res;
+	res.size = n;
+
+	const auto len = std::min(sort_profile_window, n);
+	const auto windows = std::max<size_t>(std::min(sort_profile_windows, n / len), 2);
+	for (size_t w = 0; w < windows; ++w) {
+		const auto from = w * (n - len) / (windows - 1);
+		for (auto i = from + 1; i < from + len; ++i) {
+			++res.pairs;
+			if (v[i] < v[i - 1]) {
+				++res.descents;
+			}
+		}
+	}
+	// descending runs are reversed, so mostly descending inputs have few runs too
+	const auto breaks = std::min(res.descents, res.pairs - res.descents);
+	res.runs = 1 + static_cast<size_t>(static_cast<double>(breaks) / static_cast<double>(res.pairs) * static_cast<double>(n - 1));
+
+	res.samples = std::min(sort_profile_samples, n);
+	vector<T> sample;
+	sample.reserve(res.samples);
+	for (size_t i = 0; i < res.samples; ++i) {
+		sample.push_back(v[i * n / res.samples]);
+	}
+	intro_sort(sample);
+	res.distinct = 1;
+	for (size_t i = 1; i < sample.size(); ++i) {
+		if (sample[i - 1] < sample[i]) {
+			++res.distinct;
+		}
+	}
+	res.range = key_range(sample.front(), sample.back(), is_counting_key<T>());
+	return res;
+}
+
+/// picks the sort for v from a sample of it: insertion sort for small inputs,
+/// natural_merge_sort for inputs of few runs, counting_sort for integers of a
+/// small range, radix sort for keys that have a radix_key, simd_quick_sort for
+/// smaller ranges of numbers, three_way_quick_sort for few distinct keys and
+/// intro_sort or parallel_sample_sort for the rest.
+/// from limits.parallel on up to threads threads.
+template<typename T>
+sort_plan plan_sort(vector_view<T> v, size_t threads = hardware_threads(), const auto_sort_limits& limits = auto_sort_limits()) {
+	sort_plan res;
+	const auto n = v.size();
+	res.profile.size = n;
+	if (n <= std::max<size_t>(limits.insertion, 1)) {
+		res.algorithm = sort_algorithm::insertion;
+		return res;
+	}
+	res.profile = profile_sort_input(v);
+	const auto& p = res.profile;
+	const auto parallel = n >= limits.parallel && threads > 1;
+
+	if (p.runs <= n / std::max<size_t>(limits.run_length, 1)) {
+		res.algorithm = sort_algorithm::natural_merge;
+		return res;
+	}
+	const auto small_range = [&](uint64_t range) {
+		return range != 0 && range <= limits.counting_range && range <= n;
+	};
+	if (small_range(p.range)) {
+		// the sample may have missed the smallest or the largest key
+		res.profile.range = key_range(v);
+		if (small_range(res.profile.range)) {
+			res.algorithm = sort_algorithm::counting;
+			return res;
+		}
+	}
+	if (has_radix_key<T>::value && n >= limits.radix) {
+		res.algorithm = sort_algorithm::radix;
+		res.threads = parallel ? threads : 1;
+		return res;
+	}
+	if (is_simd_sort_key<T>::value && !parallel) {
+		res.algorithm = sort_algorithm::simd_quick;
+		return res;
+	}
+	if (parallel) {
+		res.algorithm = sort_algorithm::parallel_sample;
+		res.threads = threads;
+		return res;
+	}
+	if (p.distinct <= limits.three_way_distinct) {
+		res.algorithm = sort_algorithm::three_way_quick;
+		return res;
+	}
+	res.algorithm = sort_algorithm::intro;
+	return res;
+}
+
+template<typename T>
+void run_counting_sort(vector_view<T> v, std::true_type) {
+	counting_sort(v);
+}
+
+template<typename T>
+void run_counting_sort(vector_view<T>, std::false_type) {
+	assert(false && "counting_sort takes integers only");
+}
+
+template<typename T>
+void run_radix_sort(vector_view<T> v, size_t threads, std::true_type) {
+	parallel_radix_sort(v, threads);
+}
+
+template<typename T>
+void run_radix_sort(vector_view<T>, size_t, std::false_type) {
+	assert(false && "T has no radix_key");
+}
+
+template<typename T>
+void run_simd_quick_sort(vector_view<T> v, std::true_type) {
+	simd_quick_sort(v);
+}
+
+template<typename T>
+void run_simd_quick_sort(vector_view<T>, std::false_type) {
+	assert(false && "simd_quick_sort takes numbers only");
+}
+
+/// sorts v as plan says, plan comes from plan_sort of v or a vector like it
+template<typename T>
+void run_sort_plan(vector_view<T> v, const sort_plan& plan) {
+	switch (plan.algorithm) {
+	case sort_algorithm::insertion:
+		insertion_sort(v);
+		break;
+	case sort_algorithm::natural_merge:
+		natural_merge_sort(v);
+		break;
+	case sort_algorithm::counting:
+		run_counting_sort(v, is_counting_key<T>());
+		break;
+	case sort_algorithm::radix:
+		run_radix_sort(v, plan.threads, has_radix_key<T>());
+		break;
+	case sort_algorithm::intro:
+		intro_sort(v);
+		break;
+	case sort_algorithm::three_way_quick:
+		three_way_quick_sort(v);
+		break;
+	case sort_algorithm::simd_quick:
+		run_simd_quick_sort(v, is_simd_sort_key<T>());
+		break;
+	case sort_algorithm::parallel_sample:
+		parallel_sample_sort(v, plan.threads);
+		break;
+	}
+}
+
+/// sorts v by the sort plan_sort picks and returns the plan, so the
+/// decisions can be logged and limits tuned. not stable. radix sort
+/// orders floats by their bits, -0 before 0 and NaNs at the ends,
+/// smaller inputs of floats must not have NaNs.
+template<typename T>
+sort_plan auto_sort(vector_view<T> v, size_t threads = hardware_threads(), const auto_sort_limits& limits = auto_sort_limits()) {
+	const auto plan = plan_sort(v, threads, limits);
+	run_sort_plan(v, plan);
+	return plan;
+}
+
+template<typename T>
+sort_plan auto_sort(vector<T>& v, size_t threads = hardware_threads(), const auto_sort_limits& limits = auto_sort_limits()) {
+	return auto_sort(v.view(), threads, limits);
+}
+
+}
@@ -0,0 +1,812 @@
+#include "bench.h"
+#include "vector.h"
+#include "vector_view.h"
+
+#include "heap.h"
+#include "search_tree.h"
+#include "hash_map.h"
+#include "concurrent_hash_map.h"
+
+#include "search.h"
+#include "static_search.h"
+#include "merge.h"
+#include "external_sort.h"
+#include "sample_sort.h"
+#include "radix_sort.h"
+#include "argsort.h"
+#include "string_sort.h"
+#include "block_merge_sort.h"
+#include "sort_probe.h"
+#include "auto_sort.h"
+#include "simd_sort.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+
+namespace algo {
+
+static size_t sink = 0;
+
+static bool matches(const char * filter, const char * name) {
+	return strncmp(name, filter, strlen(filter)) == 0;
+}
+
+/// the recursive binary_search this library used to have, kept as a baseline
+template<typename T>
+static T * recursive_binary_search(vector_view<T> vec, const T& val) {
+	if (vec.empty()) {
+		return nullptr;
+	}
+
+	const auto middle = vec.size() / 2;
+	if (val == vec[middle]) {
+		return &vec[middle];
+	}
+	else if (val > vec[middle]) {
+		return recursive_binary_search(vec.view(middle + 1), val);
+	}
+	return recursive_binary_search(vec.view(0, middle), val);
+}
+
+static void search_bench(size_t max_bytes) {
+	const size_t Q = 1 << 20;
+	printf("%-24s %14s %10s\n", "search", "bytes", "ns/op");
+	for (size_t bytes = 1 << 12; bytes <= max_bytes; bytes *= 4) {
+		const auto n = bytes / sizeof(int);
+		vector<int> vec(n, 0);
+		for (size_t i = 0; i < n; ++i) {
+			vec[i] = static_cast<int>(2 * i);
+		}
+		vector<int> queries(Q, 0);
+		for (size_t i = 0; i < Q; ++i) {
+			queries[i] = static_cast<int>(rand() % (2 * n));
+		}
+
+		const auto view = vec.view();
+		printf("%-24s %14zu %10.2f\n", "recursive_binary_search", bytes, bench_ns(Q, [&]() {
+			for (size_t i = 0; i < Q; ++i) {
+				sink += recursive_binary_search(view, queries[i]) != nullptr;
+			}
+		}));
+		printf("%-24s %14zu %10.2f\n", "binary_search", bytes, bench_ns(Q, [&]() {
+			for (size_t i = 0; i < Q; ++i) {
+				sink += binary_search(view, queries[i]) != nullptr;
+			}
+		}));
+		printf("%-24s %14zu %10.2f\n", "lower_bound", bytes, bench_ns(Q, [&]() {
+			for (size_t i = 0; i < Q; ++i) {
+				sink += lower_bound(view, queries[i]) - view.data();
+			}
+		}));
+		printf("%-24s %14zu %10.2f\n", "std::lower_bound", bytes, bench_ns(Q, [&]() {
+			for (size_t i = 0; i < Q; ++i) {
+				sink += std::lower_bound(vec.begin(), vec.end(), queries[i]) - vec.begin();
+			}
+		}));
+	}
+}
+
+static void static_search_bench(size_t max_bytes) {
+	const size_t Q = 1 << 20;
+	printf("%-24s %14s %10s\n", "static_search", "bytes", "ns/op");
+	for (size_t bytes = 1 << 12; bytes <= max_bytes; bytes *= 4) {
+		const auto n = bytes / sizeof(int);
+		vector<int> vec(n, 0);
+		for (size_t i = 0; i < n; ++i) {
+			vec[i] = static_cast<int>(2 * i);
+		}
+		vector<int> queries(Q, 0);
+		for (size_t i = 0; i < Q; ++i) {
+			queries[i] = static_cast<int>(rand() % (2 * n - 1));
+		}
+
+		const auto view = vec.view();
+		printf("%-24s %14zu %10.2f\n", "lower_bound", bytes, bench_ns(Q, [&]() {
+			for (size_t i = 0; i < Q; ++i) {
+				sink += *lower_bound(view, queries[i]);
+			}
+		}));
+		{
+			eytzinger_index<int> index(vec);
+			printf("%-24s %14zu %10.2f\n", "eytzinger_index", bytes, bench_ns(Q, [&]() {
+				for (size_t i = 0; i < Q; ++i) {
+					sink += *lower_bound(index, queries[i]);
+				}
+			}));
+		}
+		{
+			stree_index<int> index(vec);
+			printf("%-24s %14zu %10.2f\n", "stree_index", bytes, bench_ns(Q, [&]() {
+				for (size_t i = 0; i < Q; ++i) {
+					sink += *lower_bound(index, queries[i]);
+				}
+			}));
+		}
+	}
+}
+
+static void linear_search_bench(size_t max_bytes) {
+	const size_t Q = 1 << 16;
+	printf("%-24s %14s %10s\n", "linear_search", "bytes", "ns/op");
+	for (size_t bytes = 64; bytes <= (1 << 16) && bytes <= max_bytes; bytes *= 4) {
+		const auto n = bytes / sizeof(int);
+		vector<int> vec(n, 0);
+		for (size_t i = 0; i < n; ++i) {
+			vec[i] = static_cast<int>(i);
+		}
+		vector<int> queries(Q, 0);
+		for (size_t i = 0; i < Q; ++i) {
+			queries[i] = static_cast<int>(rand() % (n + n / 8 + 1));
+		}
+
+		printf("%-24s %14zu %10.2f\n", "indexed loop", bytes, bench_ns(Q, [&]() {
+			for (size_t q = 0; q < Q; ++q) {
+				for (size_t i = 0; i < vec.size(); ++i) {
+					if (vec[i] == queries[q]) {
+						sink += i;
+						break;
+					}
+				}
+			}
+		}));
+		printf("%-24s %14zu %10.2f\n", "find_first_scalar", bytes, bench_ns(Q, [&]() {
+			for (size_t q = 0; q < Q; ++q) {
+				sink += find_first_scalar(vec.data(), n, queries[q]);
+			}
+		}));
+		printf("%-24s %14zu %10.2f\n", "linear_search", bytes, bench_ns(Q, [&]() {
+			for (size_t q = 0; q < Q; ++q) {
+				sink += linear_search(vec, queries[q]) != nullptr;
+			}
+		}));
+		printf("%-24s %14zu %10.2f\n", "count_equal", bytes, bench_ns(Q, [&]() {
+			for (size_t q = 0; q < Q; ++q) {
+				sink += count_equal(vec, queries[q]);
+			}
+		}));
+	}
+}
+
+static void batch_search_bench(size_t max_bytes) {
+	const size_t Q = 1 << 20;
+	printf("%-24s %14s %10s\n", "batch_search", "bytes", "ns/op");
+	vector<size_t> out;
+	for (size_t bytes = 1 << 12; bytes <= max_bytes; bytes *= 4) {
+		const auto n = bytes / sizeof(int);
+		vector<int> vec(n, 0);
+		for (size_t i = 0; i < n; ++i) {
+			vec[i] = static_cast<int>(2 * i);
+		}
+		vector<int> queries(Q, 0);
+		for (size_t i = 0; i < Q; ++i) {
+			queries[i] = static_cast<int>(rand() % (2 * n));
+		}
+
+		const auto view = vec.view();
+		printf("%-24s %14zu %10.2f\n", "binary_search", bytes, bench_ns(Q, [&]() {
+			for (size_t i = 0; i < Q; ++i) {
+				sink += binary_search(view, queries[i]) != nullptr;
+			}
+		}));
+		printf("%-24s %14zu %10.2f\n", "batch_search", bytes, bench_ns(Q, [&]() {
+			batch_search(vec, queries, out);
+			sink += out[Q / 2];
+		}));
+		std::sort(queries.begin(), queries.end());
+		printf("%-24s %14zu %10.2f\n", "batch_search sorted", bytes, bench_ns(Q, [&]() {
+			batch_search(vec, queries, out);
+			sink += out[Q / 2];
+		}));
+	}
+}
+
+static void hash_map_bench(size_t max_bytes) {
+	const size_t Q = 1 << 20;
+	printf("%-24s %14s %10s %10s\n", "hash_map", "elements", "insert", "find");
+	for (size_t n = 1 << 10; n * 2 * sizeof(int) <= max_bytes && n <= (1 << 24); n *= 4) {
+		vector<int> keys(n, 0);
+		for (size_t i = 0; i < n; ++i) {
+			keys[i] = rand();
+		}
+		vector<int> queries(Q, 0);
+		for (size_t i = 0; i < Q; ++i) {
+			// half of the lookups hit
+			queries[i] = i % 2 == 0 ? keys[rand() % n] : rand();
+		}
+
+		{
+			binary_tree<int> tree;
+			const auto ins = bench_ns(n, [&]() {
+				for (size_t i = 0; i < n; ++i) {
+					tree.insert(keys[i]);
+				}
+			});
+			printf("%-24s %14zu %10.2f %10.2f\n", "binary_tree", n, ins, bench_ns(Q, [&]() {
+				for (size_t i = 0; i < Q; ++i) {
+					sink += tree.find(queries[i]) != nullptr;
+				}
+			}));
+		}
+		{
+			std::unordered_map<int, int> map;
+			const auto ins = bench_ns(n, [&]() {
+				for (size_t i = 0; i < n; ++i) {
+					map.emplace(keys[i], i);
+				}
+			});
+			printf("%-24s %14zu %10.2f %10.2f\n", "std::unordered_map", n, ins, bench_ns(Q, [&]() {
+				for (size_t i = 0; i < Q; ++i) {
+					sink += map.find(queries[i]) != map.end();
+				}
+			}));
+		}
+		{
+			hash_map<int, int> map;
+			const auto ins = bench_ns(n, [&]() {
+				for (size_t i = 0; i < n; ++i) {
+					map.insert(keys[i], i);
+				}
+			});
+			printf("%-24s %14zu %10.2f %10.2f\n", "hash_map", n, ins, bench_ns(Q, [&]() {
+				for (size_t i = 0; i < Q; ++i) {
+					sink += map.find(queries[i]) != nullptr;
+				}
+			}));
+		}
+	}
+}
+
+/// every thread runs ops operations on a shared map, writes percent of them are upserts
+static double concurrent_hash_map_mops(concurrent_hash_map<int, int>& map, size_t keys, size_t threads, size_t ops, size_t writes) {
+	const auto ns = bench_ns(ops * threads, [&]() {
+		vector<std::thread> pool;
+		for (size_t t = 0; t < threads; ++t) {
+			pool.push_back(std::thread([&map, keys, ops, writes, t]() {
+				uint64_t state = t + 1;
+				size_t hits = 0;
+				for (size_t i = 0; i < ops; ++i) {
+					state = hash_mix(state);
+					const auto key = static_cast<int>(state % keys);
+					if (state >> 32 < writes * 42949673) {
+						map.upsert(key, static_cast<int>(i));
+					}
+					else {
+						int v = 0;
+						hits += map.find(key, v);
+					}
+				}
+				__atomic_add_fetch(&sink, hits, __ATOMIC_RELAXED);
+			}));
+		}
+		for (auto& t : pool) {
+			t.join();
+		}
+	});
+	return 1e3 / ns;
+}
+
+static void concurrent_hash_map_bench(size_t max_bytes) {
+	const size_t keys = max_bytes / 32 < (1 << 20) ? max_bytes / 32 : (1 << 20);
+	const size_t ops = 1 << 20;
+	printf("%-24s %14s %10s %10s\n", "concurrent_hash_map", "threads", "read Mop/s", "write Mop/s");
+	for (size_t threads = 1; threads <= 64; threads *= 2) {
+		concurrent_hash_map<int, int> map;
+		for (size_t i = 0; i < keys; i += 2) {
+			map.insert(static_cast<int>(i), static_cast<int>(i));
+		}
+		const auto read = concurrent_hash_map_mops(map, keys, threads, ops / threads, 5);
+		const auto write = concurrent_hash_map_mops(map, keys, threads, ops / threads, 50);
+		printf("%-24s %14zu %10.2f %10.2f\n", "", threads, read, write);
+	}
+}
+
+/// k-way merge with a max heap of negated heads, 2 log k comparisons per element
+static void heap_multiway_merge(const vector<vector_view<const int>>& inputs, vector<int>& out) {
+	heap_map<int, size_t> heads;
+	vector<size_t> pos(inputs.size(), 0);
+	for (size_t i = 0; i < inputs.size(); ++i) {
+		if (!inputs[i].empty()) {
+			heads.push(-inputs[i][0], i);
+		}
+	}
+	size_t cnt = 0;
+	while (!heads.empty()) {
+		const auto head = heads.pop_max();
+		out[cnt] = -head.first;
+		++cnt;
+		const auto src = head.second;
+		if (++pos[src] < inputs[src].size()) {
+			heads.push(-inputs[src][pos[src]], src);
+		}
+	}
+}
+
+static void multiway_merge_bench(size_t max_bytes) {
+	const auto n = max_bytes / sizeof(int);
+	printf("%-24s %14s %10s %10s\n", "multiway_merge", "k", "heap", "loser_tree");
+	for (size_t k = 2; k <= 1024; k *= 4) {
+		vector<int> vec(n, 0);
+		for (size_t i = 0; i < n; ++i) {
+			vec[i] = rand();
+		}
+		vector<vector_view<const int>> inputs;
+		for (size_t i = 0; i < k; ++i) {
+			auto run = vec.view(i * n / k, (i + 1) * n / k);
+			quick_sort(run);
+			inputs.push_back(run);
+		}
+		vector<int> out(n, 0);
+		const auto heap_ns = bench_ns(n, [&]() {
+			heap_multiway_merge(inputs, out);
+		});
+		sink += out[n / 2];
+		const auto tree_ns = bench_ns(n, [&]() {
+			multiway_merge(inputs, out);
+		});
+		sink += out[n / 2];
+		printf("%-24s %14zu %10.2f %10.2f\n", "", k, heap_ns, tree_ns);
+	}
+}
+
+/// GB/s of merges of max_bytes of ints from 2 and 8 inputs and of sorts on 1 to 8 threads
+static void parallel_merge_bench(size_t max_bytes) {
+	const auto n = max_bytes / sizeof(int);
+	vector<int> vec(n, 0);
+	for (size_t i = 0; i < n; ++i) {
+		vec[i] = rand();
+	}
+	vector<int> out(n, 0);
+	printf("%-24s %14s %10s %10s %10s\n", "parallel_merge", "threads", "2 way GB/s", "8 way GB/s", "sort ns");
+	const auto gbs = [&](double ns_per_elem) {
+		// every element is read once and written once
+		return 2 * sizeof(int) / ns_per_elem;
+	};
+	for (size_t threads = 1; threads <= 8; threads *= 2) {
+		double ns[2];
+		const size_t ks[2] = {2, 8};
+		for (size_t t = 0; t < 2; ++t) {
+			auto tmp = vec;
+			vector<vector_view<const int>> inputs;
+			for (size_t i = 0; i < ks[t]; ++i) {
+				auto run = tmp.view(i * n / ks[t], (i + 1) * n / ks[t]);
+				quick_sort(run);
+				inputs.push_back(run);
+			}
+			ns[t] = bench_ns(n, [&]() {
+				parallel_multiway_merge<int>(inputs.view(), out.view(), threads);
+			});
+			sink += out[n / 2];
+		}
+		auto tmp = vec;
+		const auto sort_ns = bench_ns(n, [&]() {
+			parallel_merge_sort(tmp, threads);
+		});
+		sink += tmp[n / 2];
+		printf("%-24s %14zu %10.2f %10.2f %10.2f\n", "", threads, gbs(ns[0]), gbs(ns[1]), sort_ns);
+	}
+}
+
+/// sorts a file of max_bytes random ints with an eighth to a half of it as memory
+static void external_sort_bench(size_t max_bytes) {
+	char in_path[] = "/tmp/algo_bench_in_XXXXXX";
+	char out_path[] = "/tmp/algo_bench_out_XXXXXX";
+	file_handle in(mkstemp(in_path));
+	file_handle out(mkstemp(out_path));
+	const auto n = max_bytes / sizeof(int);
+	vector<int> vec(n, 0);
+	for (size_t i = 0; i < n; ++i) {
+		vec[i] = rand();
+	}
+	if (!in.valid() || !out.valid() || !pwrite_all(in.get(), vec.data(), n * sizeof(int), 0)) {
+		printf("external_sort: cannot write %s\n", in_path);
+		return;
+	}
+
+	printf("%-24s %14s %10s %10s %6s %6s %10s\n", "external_sort", "bytes", "memory", "ns/elem", "runs", "passes", "io MiB");
+	for (size_t memory = max_bytes / 8; memory <= max_bytes / 2; memory *= 2) {
+		external_sort_stats stats;
+		bool ok = false;
+		const auto ns = bench_ns(n, [&]() {
+			ok = external_sort<int>(in_path, out_path, memory, stats);
+		});
+		printf("%-24s %14zu %10zu %10.2f %6zu %6zu %10zu%s\n", "", max_bytes, memory, ns, stats.runs, stats.passes,
+			(stats.bytes_read + stats.bytes_written) >> 20, ok ? "" : " failed");
+	}
+	unlink(in_path);
+	unlink(out_path);
+}
+
+/// sorts max_bytes of random ints and of ints with 16 distinct values
+static void sort_bench(size_t max_bytes) {
+	const auto n = max_bytes / sizeof(int);
+	vector<int> random(n, 0);
+	vector<int> few(n, 0);
+	for (size_t i = 0; i < n; ++i) {
+		random[i] = rand();
+		few[i] = rand() % 16;
+	}
+	const auto threads = hardware_threads();
+	printf("%-24s %10s %10s\n", "sort", "random ns", "16 keys ns");
+	const auto run = [&](const char * name, void (*f)(vector<int>&)) {
+		double ns[2];
+		const vector<int> * inputs[2] = {&random, &few};
+		for (size_t i = 0; i < 2; ++i) {
+			auto tmp = *inputs[i];
+			ns[i] = bench_ns(n, [&]() {
+				f(tmp);
+			});
+			sink += tmp[n / 2];
+		}
+		printf("  %-22s %10.2f %10.2f\n", name, ns[0], ns[1]);
+	};
+	run("quick_sort", [](vector<int>& v) { quick_sort(v); });
+	run("merge_sort", [](vector<int>& v) {
+		vector<int> buf(v.size(), 0);
+		merge_sort(v.view(), buf.view());
+	});
+	run("std::sort", [](vector<int>& v) { std::sort(v.begin(), v.end()); });
+	run("sample_sort", [](vector<int>& v) { sample_sort(v); });
+	run("parallel_merge_sort", [](vector<int>& v) { parallel_merge_sort(v); });
+	run("parallel_sample_sort", [](vector<int>& v) { parallel_sample_sort(v); });
+	printf("  %-22s %10zu\n", "threads", threads);
+}
+
+/// radix sorts max_bytes of random keys, GB/s counts the bytes of keys sorted
+template<typename T>
+static void radix_sort_bench(size_t max_bytes, const char * name) {
+	const auto n = max_bytes / sizeof(T);
+	vector<T> vec(n, 0);
+	for (size_t i = 0; i < n; ++i) {
+		vec[i] = static_cast<T>(static_cast<int64_t>(static_cast<uint64_t>(rand()) << 33 ^ static_cast<uint64_t>(rand()) << 11 ^ rand()) - (static_cast<int64_t>(1) << 62));
+	}
+	printf("%-24s %14s %10s %10s\n", name, "threads", "ns", "GB/s");
+	auto tmp = vec;
+	const auto std_ns = bench_ns(n, [&]() {
+		std::sort(tmp.begin(), tmp.end());
+	});
+	sink += tmp[n / 2];
+	printf("  %-22s %14s %10.2f %10.2f\n", "std::sort", "1", std_ns, sizeof(T) / std_ns);
+	for (size_t threads = 1; threads <= 8; threads *= 2) {
+		tmp = vec;
+		const auto ns = bench_ns(n, [&]() {
+			parallel_radix_sort(tmp, threads);
+		});
+		sink += tmp[n / 2];
+		printf("  %-22s %14zu %10.2f %10.2f\n", "parallel_radix_sort", threads, ns, sizeof(T) / ns);
+	}
+}
+
+/// a record of a 32 bit key and a cache line of payload
+struct bench_record {
+	bench_record() = default;
+	bench_record(uint32_t k) : key(k) {}
+
+	uint32_t key{0};
+	uint32_t payload[15];
+};
+
+/// sorts max_bytes of records by sorting them whole and by key
+static void sort_by_key_bench(size_t max_bytes) {
+	const auto n = max_bytes / sizeof(bench_record);
+	vector<bench_record> records(n, bench_record());
+	vector<uint32_t> keys(n, 0);
+	for (size_t i = 0; i < n; ++i) {
+		keys[i] = static_cast<uint32_t>(rand());
+		records[i] = bench_record(keys[i]);
+	}
+	printf("%-24s %10s\n", "sort_by_key", "ns");
+	const auto run = [&](const char * name, void (*f)(vector<uint32_t>&, vector<bench_record>&)) {
+		auto k = keys;
+		auto v = records;
+		const auto ns = bench_ns(n, [&]() {
+			f(k, v);
+		});
+		sink += v[n / 2].key;
+		printf("  %-22s %10.2f\n", name, ns);
+	};
+	run("quick_sort records", [](vector<uint32_t>&, vector<bench_record>& v) {
+		quick_sort(v, less(), [](const bench_record& r) {
+			return r.key;
+		});
+	});
+	run("sort_by_key", [](vector<uint32_t>& k, vector<bench_record>& v) { sort_by_key(k, v); });
+	run("stable_sort_by_key", [](vector<uint32_t>& k, vector<bench_record>& v) { stable_sort_by_key(k, v); });
+	run("radix_sort_by_key", [](vector<uint32_t>& k, vector<bench_record>& v) { radix_sort_by_key(k, v); });
+	run("radix_argsort", [](vector<uint32_t>& k, vector<bench_record>&) { sink += radix_argsort(k)[0]; });
+}
+
+/// sorts url like strings: a few hosts, then paths of words
+static void string_sort_bench(size_t max_bytes) {
+	const char * hosts[] = {"http://www.example.com/", "https://example.org/wiki/", "http://localhost:8080/api/v1/"};
+	const char * words[] = {"index", "users", "items", "search", "a", "b", "c", "page", "html", "2024"};
+	vector<std::string> strings;
+	size_t bytes = 0;
+	while (bytes < max_bytes / 4) {
+		std::string s = hosts[rand() % 3];
+		const auto parts = 1 + rand() % 5;
+		for (int i = 0; i < parts; ++i) {
+			s += words[rand() % 10];
+			s += '/';
+		}
+		s += std::to_string(rand() % 1000);
+		bytes += s.size() + 1;
+		strings.push_back(s);
+	}
+	vector<const char *> ptrs;
+	for (size_t i = 0; i < strings.size(); ++i) {
+		ptrs.push_back(strings[i].c_str());
+	}
+	const auto n = ptrs.size();
+	printf("%-24s %10zu strings %10s\n", "string_sort", n, "ns");
+	const auto run = [&](const char * name, void (*f)(vector<const char *>&)) {
+		auto tmp = ptrs;
+		const auto ns = bench_ns(n, [&]() {
+			f(tmp);
+		});
+		sink += tmp[n / 2][0];
+		printf("  %-22s %29.2f\n", name, ns);
+	};
+	run("std::sort strcmp", [](vector<const char *>& v) {
+		std::sort(v.begin(), v.end(), [](const char * a, const char * b) {
+			return strcmp(a, b) < 0;
+		});
+	});
+	run("merge_sort strcmp", [](vector<const char *>& v) {
+		merge_sort(v, [](const char * a, const char * b) {
+			return strcmp(a, b) < 0;
+		});
+	});
+	run("multikey_quick_sort", [](vector<const char *>& v) { multikey_quick_sort(v); });
+	run("msd_string_sort", [](vector<const char *>& v) { msd_string_sort(v); });
+	run("msd_string_sort lcp", [](vector<const char *>& v) {
+		vector<size_t> lcp;
+		msd_string_sort(v, lcp);
+		sink += lcp[v.size() / 2];
+	});
+	auto tmp = strings;
+	const auto ns = bench_ns(n, [&]() {
+		msd_string_sort(tmp);
+	});
+	sink += tmp[n / 2].size();
+	printf("  %-22s %29.2f\n", "msd_string_sort string", ns);
+}
+
+/// stable sorts of max_bytes of random ints and of pairs of int keys with 16 distinct values
+static void stable_sort_bench(size_t max_bytes) {
+	const auto n = max_bytes / sizeof(int);
+	vector<int> ints(n, 0);
+	vector<pair<int, int>> pairs(n / 2, pair<int, int>());
+	for (size_t i = 0; i < n; ++i) {
+		ints[i] = rand();
+	}
+	for (size_t i = 0; i < n / 2; ++i) {
+		pairs[i] = pair<int, int>(rand() % 16, static_cast<int>(i));
+	}
+	printf("%-24s %10s %10s %14s\n", "stable_sort", "ints ns", "pairs ns", "extra memory");
+	const auto run = [&](const char * name, const char * memory, void (*f)(vector<int>&), void (*g)(vector<pair<int, int>>&)) {
+		auto a = ints;
+		const auto ns = bench_ns(n, [&]() {
+			f(a);
+		});
+		auto b = pairs;
+		const auto pair_ns = bench_ns(n / 2, [&]() {
+			g(b);
+		});
+		sink += a[n / 2] + b[n / 4].second;
+		printf("  %-22s %10.2f %10.2f %14s\n", name, ns, pair_ns, memory);
+	};
+	run("merge_sort", "n", [](vector<int>& v) { merge_sort(v); }, [](vector<pair<int, int>>& v) { merge_sort(v); });
+	run("std::stable_sort", "n", [](vector<int>& v) { std::stable_sort(v.begin(), v.end()); },
+		[](vector<pair<int, int>>& v) { std::stable_sort(v.begin(), v.end()); });
+	run("block_merge_sort", "sqrt n", [](vector<int>& v) { block_merge_sort(v); }, [](vector<pair<int, int>>& v) { block_merge_sort(v); });
+}
+
+/// the work behind the times of sort: comparisons, copies and moves per element of
+/// counted ints, recursion depth and allocations if the hooks are compiled in and
+/// cycles and branch misses per element if the hardware counters can be read
+static void sort_stats_bench(size_t max_bytes) {
+	const auto n = max_bytes / sizeof(int);
+	vector<counted<int>> random(n, counted<int>());
+	for (size_t i = 0; i < n; ++i) {
+		random[i] = counted<int>(rand());
+	}
+	printf("%-24s %10s %10s %10s %6s %6s %10s %10s\n", "sort_stats", "cmp/n", "copies/n", "moves/n",
+		"depth", "allocs", "cycles/n", "misses/n");
+	const auto run = [&](const char * name, void (*f)(vector<counted<int>>&)) {
+		auto tmp = random;
+		sort_stats stats;
+		{
+			sort_probe probe(stats);
+			f(tmp);
+		}
+		sink += tmp[n / 2].get();
+		const auto per = [&](double x) {
+			return x / static_cast<double>(n);
+		};
+		printf("  %-22s %10.2f %10.2f %10.2f", name, per(stats.comparisons), per(stats.copies), per(stats.moves));
+#ifdef ALGO_SORT_STATS
+		printf(" %6zu %6zu", stats.max_depth, stats.allocations);
+#else
+		printf(" %6s %6s", "-", "-");
+#endif
+		if (stats.perf) {
+			printf(" %10.2f %10.2f\n", per(stats.cycles), per(stats.branch_misses));
+		}
+		else {
+			printf(" %10s %10s\n", "-", "-");
+		}
+	};
+	run("quick_sort", [](vector<counted<int>>& v) { quick_sort(v); });
+	run("merge_sort", [](vector<counted<int>>& v) { merge_sort(v); });
+	run("heap_sort", [](vector<counted<int>>& v) { heap_sort(v); });
+	run("block_merge_sort", [](vector<counted<int>>& v) { block_merge_sort(v); });
+	run("sample_sort", [](vector<counted<int>>& v) { sample_sort(v); });
+	run("std::sort", [](vector<counted<int>>& v) { std::sort(v.begin(), v.end()); });
+}
+
+/// auto_sort against intro_sort and std::sort on inputs that each favor another
+/// sort, with the sort auto_sort picked
+static void auto_sort_bench(size_t max_bytes) {
+	const auto n = max_bytes / sizeof(int);
+	const char * names[] = {"random", "sorted", "reversed", "100 keys", "sorted + 1%"};
+	vector<int> inputs[5];
+	for (auto& v : inputs) {
+		v = vector<int>(n, 0);
+	}
+	for (size_t i = 0; i < n; ++i) {
+		inputs[0][i] = rand();
+		inputs[1][i] = static_cast<int>(i);
+		inputs[2][i] = static_cast<int>(n - i);
+		inputs[3][i] = rand() % 100;
+		inputs[4][i] = rand() % 100 == 0 ? rand() : static_cast<int>(i);
+	}
+	printf("%-24s %10s %10s %10s  %s\n", "auto_sort", "auto ns", "intro ns", "std ns", "picked");
+	for (size_t k = 0; k < 5; ++k) {
+		sort_plan plan;
+		auto a = inputs[k];
+		const auto auto_ns = bench_ns(n, [&]() {
+			plan = auto_sort(a);
+		});
+		auto b = inputs[k];
+		const auto intro_ns = bench_ns(n, [&]() {
+			intro_sort(b);
+		});
+		auto c = inputs[k];
+		const auto std_ns = bench_ns(n, [&]() {
+			std::sort(c.begin(), c.end());
+		});
+		sink += a[n / 2] + b[n / 3] + c[n / 4];
+		printf("  %-22s %10.2f %10.2f %10.2f  %s\n", names[k], auto_ns, intro_ns, std_ns, sort_algorithm_name(plan.algorithm));
+	}
+}
+
+/// sorts of max_bytes of ints with 2 to 100 distinct keys, like status codes
+static void few_keys_bench(size_t max_bytes) {
+	const auto n = max_bytes / sizeof(int);
+	printf("%-24s %10s %10s %10s %10s\n", "few_keys ns", "quick", "intro", "three_way", "std::sort");
+	const int keys[] = {2, 3, 5, 10, 30, 100};
+	for (auto k : keys) {
+		vector<int> input(n, 0);
+		for (size_t i = 0; i < n; ++i) {
+			input[i] = rand() % k * 1000;
+		}
+		const auto run = [&](void (*f)(vector<int>&)) {
+			auto tmp = input;
+			const auto ns = bench_ns(n, [&]() {
+				f(tmp);
+			});
+			sink += tmp[n / 2];
+			return ns;
+		};
+		const auto quick = run([](vector<int>& v) { quick_sort(v); });
+		const auto intro = run([](vector<int>& v) { intro_sort(v); });
+		const auto three_way = run([](vector<int>& v) { three_way_quick_sort(v); });
+		const auto std_ns = run([](vector<int>& v) { std::sort(v.begin(), v.end()); });
+		printf("  %-22d %10.2f %10.2f %10.2f %10.2f\n", k, quick, intro, three_way, std_ns);
+	}
+}
+
+/// simd_quick_sort of max_bytes of random keys with each kernel the cpu has,
+/// against intro_sort and std::sort
+template<typename T>
+static void simd_sort_bench(size_t max_bytes, const char * name) {
+	const auto n = max_bytes / sizeof(T);
+	vector<T> input(n, T());
+	for (size_t i = 0; i < n; ++i) {
+		input[i] = static_cast<T>((static_cast<int64_t>(rand()) - RAND_MAX / 2) * RAND_MAX + rand());
+	}
+	const auto run = [&](void (*f)(vector<T>&)) {
+		auto tmp = input;
+		const auto ns = bench_ns(n, [&]() {
+			f(tmp);
+		});
+		sink += static_cast<size_t>(tmp[n / 2]);
+		return ns;
+	};
+	const auto scalar = run([](vector<T>& v) { simd_quick_sort(v.view(), scalar_sort_kernel<T>()); });
+	double avx2 = 0;
+	double avx512 = 0;
+#ifdef __x86_64__
+	if (has_avx2()) {
+		avx2 = run([](vector<T>& v) { simd_quick_sort(v.view(), avx2_sort_kernel<T>()); });
+	}
+	if (has_avx512()) {
+		avx512 = run([](vector<T>& v) { simd_quick_sort(v.view(), avx512_sort_kernel<T>()); });
+	}
+#endif
+	const auto intro = run([](vector<T>& v) { intro_sort(v); });
+	const auto std_ns = run([](vector<T>& v) { std::sort(v.begin(), v.end()); });
+	printf("  %-22s %10.2f %10.2f %10.2f %10.2f %10.2f\n", name, scalar, avx2, avx512, intro, std_ns);
+}
+
+void benchmarks(const char * filter, size_t max_bytes) {
+	if (matches(filter, "search")) {
+		search_bench(max_bytes);
+	}
+	if (matches(filter, "linear_search")) {
+		linear_search_bench(max_bytes);
+	}
+	if (matches(filter, "batch_search")) {
+		batch_search_bench(max_bytes);
+	}
+	if (matches(filter, "hash_map")) {
+		hash_map_bench(max_bytes);
+	}
+	if (matches(filter, "concurrent_hash_map")) {
+		concurrent_hash_map_bench(max_bytes);
+	}
+	if (matches(filter, "static_search")) {
+		static_search_bench(max_bytes);
+	}
+	if (matches(filter, "multiway_merge")) {
+		multiway_merge_bench(max_bytes);
+	}
+	if (matches(filter, "parallel_merge")) {
+		parallel_merge_bench(max_bytes);
+	}
+	if (matches(filter, "external_sort")) {
+		external_sort_bench(max_bytes);
+	}
+	if (matches(filter, "sort")) {
+		sort_bench(max_bytes);
+	}
+	if (matches(filter, "radix_sort")) {
+		radix_sort_bench<uint32_t>(max_bytes, "radix_sort 32 bit");
+		radix_sort_bench<uint64_t>(max_bytes, "radix_sort 64 bit");
+		radix_sort_bench<double>(max_bytes, "radix_sort double");
+	}
+	if (matches(filter, "sort_by_key")) {
+		sort_by_key_bench(max_bytes);
+	}
+	if (matches(filter, "string_sort")) {
+		string_sort_bench(max_bytes);
+	}
+	if (matches(filter, "stable_sort")) {
+		stable_sort_bench(max_bytes);
+	}
+	if (matches(filter, "sort_stats")) {
+		sort_stats_bench(max_bytes);
+	}
+	if (matches(filter, "auto_sort")) {
+		auto_sort_bench(max_bytes);
+	}
+	if (matches(filter, "few_keys")) {
+		few_keys_bench(max_bytes);
+	}
+	if (matches(filter, "simd_sort")) {
+		printf("%-24s %10s %10s %10s %10s %10s\n", "simd_sort ns", "scalar", "avx2", "avx512", "intro", "std::sort");
+		simd_sort_bench<int32_t>(max_bytes, "int32");
+		simd_sort_bench<uint32_t>(max_bytes, "uint32");
+		simd_sort_bench<float>(max_bytes, "float");
+		simd_sort_bench<int64_t>(max_bytes, "int64");
+		simd_sort_bench<double>(max_bytes, "double");
+	}
+	printf("# %zu\n", sink);
+}
+
+}
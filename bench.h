@@ -0,0 +1,23 @@
+#pragma once
+
+#include <chrono>
+
+#include "common.h"
+
+
+namespace algo {
+
+/// runs the benchmarks whose name starts with filter,
+/// data sets grow up to max_bytes
+void benchmarks(const char * filter, size_t max_bytes);
+
+/// average nanoseconds per operation of f, which performs ops operations
+template<typename F>
+double bench_ns(size_t ops, F&& f) {
+	const auto start = std::chrono::steady_clock::now();
+	f();
+	const auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / ops;
+}
+
+}
@@ -0,0 +1,9 @@
+#include "bench.h"
+
+
+int main(int argc, char ** argv) {
+	const char * filter = argc > 1 ? argv[1] : "";
+	const size_t max_mb = argc > 2 ? strtoul(argv[2], nullptr, 10) : 64;
+	algo::benchmarks(filter, max_mb << 20);
+	return 0;
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <cmath>
+
+#include "common.h"
+#include "vector.h"
+#include "vector_view.h"
+#include "sort_stats.h"
+#include "sort.h"
+
+
+namespace algo {
+
+/// stable merge of v[0, m) and v[m, n) that moves v[0, m) to buf, which has room for it
+template<typename T, typename Less>
+void merge_forward_buffered(vector_view<T> v, size_t m, vector_view<T> buf, const Less& lt) {
+	assert(m <= buf.size());
+	const auto n = v.size();
+	std::move(v.begin(), v.begin() + m, buf.begin());
+	size_t i = 0;
+	size_t j = m;
+	size_t w = 0;
+	while (i < m && j < n) {
+		if (lt(v[j], buf[i])) {
+			v[w] = std::move(v[j]);
+			++j;
+		}
+		else {
+			v[w] = std::move(buf[i]);
+			++i;
+		}
+		++w;
+	}
+	// the rest of v[m, n) is in place already
+	std::move(buf.begin() + i, buf.begin() + m, v.begin() + w);
+}
+
+/// stable merge of v[0, m) and v[m, n) that moves v[m, n) to buf, which has room for it
+template<typename T, typename Less>
+void merge_backward_buffered(vector_view<T> v, size_t m, vector_view<T> buf, const Less& lt) {
+	const auto n = v.size();
+	const auto k = n - m;
+	assert(k <= buf.size());
+	std::move(v.begin() + m, v.end(), buf.begin());
+	auto i = m;
+	auto j = k;
+	auto w = n;
+	while (i > 0 && j > 0) {
+		--w;
+		if (lt(buf[j - 1], v[i - 1])) {
+			v[w] = std::move(v[i - 1]);
+			--i;
+		}
+		else {
+			v[w] = std::move(buf[j - 1]);
+			--j;
+		}
+	}
+	std::move(buf.begin(), buf.begin() + j, v.begin() + (w - j));
+}
+
+/// moves blocks of size bs so that slot i gets block src[i], following the cycles of the
+/// permutation through buf. marks done slots with the top bit of src and clears it after.
+template<typename T>
+void permute_blocks(vector_view<T> v, vector_view<size_t> src, size_t bs, vector_view<T> buf) {
+	const auto done = static_cast<size_t>(1) << (8 * sizeof(size_t) - 1);
+	const auto block = [&](size_t i) {
+		return v.begin() + i * bs;
+	};
+	for (size_t i = 0; i < src.size(); ++i) {
+		if ((src[i] & done) != 0 || src[i] == i) {
+			continue;
+		}
+		std::move(block(i), block(i) + bs, buf.begin());
+		auto j = i;
+		while (src[j] != i) {
+			const auto s = src[j];
+			std::move(block(s), block(s) + bs, block(j));
+			src[j] |= done;
+			j = s;
+		}
+		std::move(buf.begin(), buf.begin() + bs, block(j));
+		src[j] |= done;
+	}
+	for (size_t i = 0; i < src.size(); ++i) {
+		src[i] &= ~done;
+	}
+}
+
+/// stable merge of p blocks of a and q blocks of b, all of size bs, in place with a buffer of
+/// bs elements and a slot per block. the blocks are first put in the order of their first
+/// elements, a blocks before b blocks on ties. then every element is at most a block away
+/// from the blocks it merges with: a fragment of the last block stays in buf, is merged
+/// with the next block if that one comes from the other run and is written out as is otherwise.
+template<typename T, typename Less>
+void merge_blocks(vector_view<T> v, size_t p, size_t q, size_t bs, vector_view<T> buf, vector_view<size_t> src, const Less& lt) {
+	const auto r = p + q;
+	src = src.view(0, r);
+	size_t ia = 0;
+	size_t ib = 0;
+	for (size_t i = 0; i < r; ++i) {
+		const auto take_a = ib == q || (ia < p && !lt(v[(p + ib) * bs], v[ia * bs]));
+		src[i] = take_a ? ia++ : p + ib++;
+	}
+	permute_blocks(v, src, bs, buf);
+
+	// the fragment is buf[f, bs), the output goes to v[w, ..) and w + bs - f is the next block
+	std::move(v.begin(), v.begin() + bs, buf.begin());
+	size_t f = 0;
+	auto frag_a = src[0] < p;
+	size_t w = 0;
+	for (size_t j = 1; j < r; ++j) {
+		const auto block_a = src[j] < p;
+		auto x = j * bs;
+		const auto end = x + bs;
+		if (block_a == frag_a) {
+			std::move(buf.begin() + f, buf.begin() + bs, v.begin() + w);
+			std::move(v.begin() + x, v.begin() + end, buf.begin());
+			w = x;
+			f = 0;
+			continue;
+		}
+		while (f < bs && x < end) {
+			// equal elements of a go first
+			const auto take_x = frag_a ? lt(v[x], buf[f]) : !lt(buf[f], v[x]);
+			if (take_x) {
+				v[w] = std::move(v[x]);
+				++x;
+			}
+			else {
+				v[w] = std::move(buf[f]);
+				++f;
+			}
+			++w;
+		}
+		if (f == bs) {
+			// the rest of the block becomes the fragment
+			f = bs - (end - x);
+			std::move(v.begin() + x, v.begin() + end, buf.begin() + f);
+			frag_a = block_a;
+		}
+	}
+	std::move(buf.begin() + f, buf.begin() + bs, v.begin() + w);
+}
+
+/// stable merge of v[0, m) and v[m, n) with buf.size() elements of buffer and
+/// n / buf.size() + 1 slots in blocks, O(n) time
+template<typename T, typename Less>
+void block_merge(vector_view<T> v, size_t m, vector_view<T> buf, vector_view<size_t> blocks, const Less& lt) {
+	const auto n = v.size();
+	const auto k = n - m;
+	if (m == 0 || k == 0 || !lt(v[m], v[m - 1])) {
+		return;
+	}
+	const auto bs = buf.size();
+	if (m <= bs) {
+		merge_forward_buffered(v, m, buf, lt);
+		return;
+	}
+	if (k <= bs) {
+		merge_backward_buffered(v, m, buf, lt);
+		return;
+	}
+
+	// whole blocks in the middle, the uneven ends are merged into them after
+	const auto h = m % bs;
+	const auto t = k % bs;
+	merge_blocks(v.view(h, n - t), m / bs, k / bs, bs, buf, blocks, lt);
+	if (h > 0) {
+		merge_forward_buffered(v.view(0, n - t), h, buf, lt);
+	}
+	if (t > 0) {
+		merge_backward_buffered(v, n - t, buf, lt);
+	}
+}
+
+/// stable merge sort in O(n log n) time with O(sqrt n) memory: runs are merged by
+/// block_merge, which moves blocks of sqrt n elements into place and then merges
+/// them with their neighbors through a buffer of one block.
+template<typename T, typename Cmp, typename Proj = identity>
+void block_merge_sort(vector_view<T> v, Cmp cmp, Proj proj = Proj()) {
+	const auto lt = make_projected_less(cmp, proj);
+	const auto n = v.size();
+	const size_t run = 16;
+	for (size_t from = 0; from < n; from += run) {
+		insertion_sort(v.view(from, std::min(from + run, n)), cmp, proj);
+	}
+	if (n <= run) {
+		return;
+	}
+
+	const auto bs = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(n))));
+	ALGO_SORT_ALLOCATION(bs * sizeof(T) + (n / bs + 1) * sizeof(size_t));
+	vector<T> buf(bs, T{});
+	vector<size_t> blocks(n / bs + 1, 0);
+	for (size_t width = run; width < n; width *= 2) {
+		for (size_t from = 0; from + width < n; from += 2 * width) {
+			const auto to = std::min(from + 2 * width, n);
+			block_merge(v.view(from, to), width, buf.view(), blocks.view(), lt);
+		}
+	}
+}
+
+template<typename T, typename Cmp, typename Proj = identity>
+void block_merge_sort(vector<T>& v, Cmp cmp, Proj proj = Proj()) {
+	block_merge_sort(v.view(), cmp, proj);
+}
+
+template<typename T>
+void block_merge_sort(vector_view<T> v) {
+	block_merge_sort(v, less(), identity());
+}
+
+template<typename T>
+void block_merge_sort(vector<T>& v) {
+	block_merge_sort(v.view());
+}
+
+}
@@ -0,0 +1,636 @@
+#pragma once
+
+#include <iterator>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "common.h"
+#include "vector.h"
+#include "vector_view.h"
+#include "pair.h"
+
+
+namespace algo {
+
+/// the number of keys less than val, a branchless scan that compilers vectorize
+template<typename T>
+size_t btree_rank(const T * keys, size_t cnt, const T& val) {
+	size_t res = 0;
+	for (size_t i = 0; i < cnt; ++i) {
+		res += keys[i] < val;
+	}
+	return res;
+}
+
+#ifdef __SSE2__
+inline size_t btree_rank(const int * keys, size_t cnt, const int& val) {
+	const auto v = _mm_set1_epi32(val);
+	// every lane of a comparison is 0 or -1, so subtracting them counts matches per lane
+	auto acc = _mm_setzero_si128();
+	const auto full = cnt / 4 * 4;
+	for (size_t i = 0; i < full; i += 4) {
+		const auto k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+		acc = _mm_sub_epi32(acc, _mm_cmplt_epi32(k, v));
+	}
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+	size_t res = _mm_cvtsi128_si32(acc);
+	// at most 3 keys are left, a count the compiler knows when cnt is a constant
+	for (size_t j = 0; j < cnt % 4; ++j) {
+		res += keys[full + j] < val;
+	}
+	return res;
+}
+#endif
+
+/// B+ tree: all values live in linked leaves, inner nodes only route.
+/// N is the node capacity, by default a node's keys take 4 cache lines.
+template<typename T, size_t N = (256 / sizeof(T) > 4 ? 256 / sizeof(T) - 1 : 3)>
+class btree {
+	static_assert(N >= 3, "btree nodes must hold at least 3 keys");
+
+	static const size_t min_keys = N / 2;
+
+	struct node {
+		explicit node(bool l) : leaf(l) {}
+
+		size_t cnt{0};
+		bool leaf;
+		T keys[N + 1]; // one spare slot to overflow before a split
+	};
+
+	struct leaf_node: node {
+		leaf_node() : node(true) {}
+
+		leaf_node * next{nullptr};
+		leaf_node * prev{nullptr};
+	};
+
+	struct inner_node: node {
+		inner_node() : node(false) {}
+
+		node * children[N + 2];
+	};
+
+public:
+	using type = T;
+
+	class iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const T*;
+		using reference = const T&;
+
+		iterator() = default;
+		iterator(const leaf_node * l, size_t i) : leaf(l), idx(i) {}
+
+		reference operator*() const {
+			return leaf->keys[idx];
+		}
+
+		pointer operator->() const {
+			return &leaf->keys[idx];
+		}
+
+		iterator& operator++() {
+			++idx;
+			if (idx == leaf->cnt) {
+				leaf = leaf->next;
+				idx = 0;
+			}
+			return *this;
+		}
+
+		iterator operator++(int) {
+			auto res = *this;
+			++*this;
+			return res;
+		}
+
+		bool operator==(const iterator& r) const {
+			return leaf == r.leaf && idx == r.idx;
+		}
+
+		bool operator!=(const iterator& r) const {
+			return !(*this == r);
+		}
+
+	private:
+		const leaf_node * leaf{nullptr};
+		size_t idx{0};
+	};
+
+	btree() = default;
+
+	btree(const btree& r) {
+		vector<T> tmp;
+		tmp.reserve(r.size());
+		for (const auto& v : r) {
+			tmp.push_back(v);
+		}
+		build(tmp.view());
+	}
+
+	btree(btree&& r) {
+		swap(r);
+	}
+
+	~btree() {
+		drop(root);
+	}
+
+	btree& operator=(const btree& r) {
+		btree tmp(r);
+		swap(tmp);
+		return *this;
+	}
+
+	btree& operator=(btree&& r) {
+		swap(r);
+		return *this;
+	}
+
+	/// bulk load from strictly increasing values
+	explicit btree(vector_view<const T> sorted) {
+		build(sorted);
+	}
+
+	explicit btree(const vector<T>& sorted) : btree(sorted.view()) {}
+
+	size_t size() const {
+		return cnt;
+	}
+
+	bool empty() const {
+		return cnt == 0;
+	}
+
+	size_t hight() const {
+		size_t res = 0;
+		for (const auto * n = root; n != nullptr; ++res) {
+			n = n->leaf ? nullptr : static_cast<const inner_node*>(n)->children[0];
+		}
+		return res;
+	}
+
+	void swap(btree& r) {
+		using std::swap;
+		swap(root, r.root);
+		swap(first, r.first);
+		swap(last, r.last);
+		swap(cnt, r.cnt);
+	}
+
+	bool insert(const T& val) {
+		if (root == nullptr) {
+			auto * l = new leaf_node();
+			l->keys[0] = val;
+			l->cnt = 1;
+			root = first = last = l;
+			++cnt;
+			return true;
+		}
+
+		T sep;
+		node * split = nullptr;
+		if (!insert(root, val, sep, split)) {
+			return false;
+		}
+		if (split != nullptr) {
+			auto * r = new inner_node();
+			r->keys[0] = sep;
+			r->children[0] = root;
+			r->children[1] = split;
+			r->cnt = 1;
+			root = r;
+		}
+		++cnt;
+		return true;
+	}
+
+	T * find(const T& val) {
+		const auto it = lower_bound(val);
+		return it == end() || !(*it == val) ? nullptr : const_cast<T*>(&*it);
+	}
+
+	const T * find(const T& val) const {
+		const auto it = lower_bound(val);
+		return it == end() || !(*it == val) ? nullptr : &*it;
+	}
+
+	bool remove(const T& val) {
+		if (root == nullptr || !remove(root, val)) {
+			return false;
+		}
+		--cnt;
+		if (root->cnt == 0) {
+			auto * old = root;
+			if (root->leaf) {
+				root = first = last = nullptr;
+				delete static_cast<leaf_node*>(old);
+			}
+			else {
+				root = static_cast<inner_node*>(old)->children[0];
+				delete static_cast<inner_node*>(old);
+			}
+		}
+		return true;
+	}
+
+	T * min() {
+		return first == nullptr ? nullptr : &first->keys[0];
+	}
+
+	const T * min() const {
+		return first == nullptr ? nullptr : &first->keys[0];
+	}
+
+	T * max() {
+		return last == nullptr ? nullptr : &last->keys[last->cnt - 1];
+	}
+
+	const T * max() const {
+		return last == nullptr ? nullptr : &last->keys[last->cnt - 1];
+	}
+
+	iterator begin() const {
+		return iterator(first, 0);
+	}
+
+	iterator end() const {
+		return iterator();
+	}
+
+	/// the first value not less than val
+	iterator lower_bound(const T& val) const {
+		if (root == nullptr) {
+			return end();
+		}
+		const auto * l = find_leaf(val);
+		const auto i = btree_rank(l->keys, l->cnt, val);
+		if (i == l->cnt) {
+			return iterator(l->next, 0);
+		}
+		return iterator(l, i);
+	}
+
+	/// the first value greater than val
+	iterator upper_bound(const T& val) const {
+		auto it = lower_bound(val);
+		if (it != end() && *it == val) {
+			++it;
+		}
+		return it;
+	}
+
+	/// values in [from, to)
+	iterator_range<iterator> range(const T& from, const T& to) const {
+		assert(!(to < from));
+		return iterator_range<iterator>(lower_bound(from), lower_bound(to));
+	}
+
+private:
+	/// index of the child whose subtree may contain val
+	static size_t child_index(const node * n, const T& val) {
+		const auto i = btree_rank(n->keys, n->cnt, val);
+		return i < n->cnt && n->keys[i] == val ? i + 1 : i;
+	}
+
+	const leaf_node * find_leaf(const T& val) const {
+		const auto * n = root;
+		while (!n->leaf) {
+			n = static_cast<const inner_node*>(n)->children[child_index(n, val)];
+		}
+		return static_cast<const leaf_node*>(n);
+	}
+
+	static void drop(node * n) {
+		if (n == nullptr) {
+			return;
+		}
+		if (n->leaf) {
+			delete static_cast<leaf_node*>(n);
+			return;
+		}
+		auto * in = static_cast<inner_node*>(n);
+		for (size_t i = 0; i <= in->cnt; ++i) {
+			drop(in->children[i]);
+		}
+		delete in;
+	}
+
+	/// inserts val below n, on overflow n is split and the new right sibling is returned via split
+	bool insert(node * n, const T& val, T& sep, node *& split) {
+		if (n->leaf) {
+			auto * l = static_cast<leaf_node*>(n);
+			const auto pos = btree_rank(l->keys, l->cnt, val);
+			if (pos < l->cnt && l->keys[pos] == val) {
+				return false;
+			}
+			for (size_t i = l->cnt; i > pos; --i) {
+				l->keys[i] = std::move(l->keys[i - 1]);
+			}
+			l->keys[pos] = val;
+			++l->cnt;
+			if (l->cnt > N) {
+				split = split_leaf(l);
+				sep = split->keys[0];
+			}
+			return true;
+		}
+
+		auto * in = static_cast<inner_node*>(n);
+		const auto pos = child_index(in, val);
+		T child_sep;
+		node * child_split = nullptr;
+		if (!insert(in->children[pos], val, child_sep, child_split)) {
+			return false;
+		}
+		if (child_split == nullptr) {
+			return true;
+		}
+
+		for (size_t i = in->cnt; i > pos; --i) {
+			in->keys[i] = std::move(in->keys[i - 1]);
+			in->children[i + 1] = in->children[i];
+		}
+		in->keys[pos] = std::move(child_sep);
+		in->children[pos + 1] = child_split;
+		++in->cnt;
+		if (in->cnt > N) {
+			split = split_inner(in, sep);
+		}
+		return true;
+	}
+
+	leaf_node * split_leaf(leaf_node * l) {
+		auto * r = new leaf_node();
+		const auto keep = l->cnt / 2;
+		for (size_t i = keep; i < l->cnt; ++i) {
+			r->keys[i - keep] = std::move(l->keys[i]);
+		}
+		r->cnt = l->cnt - keep;
+		l->cnt = keep;
+
+		r->next = l->next;
+		r->prev = l;
+		if (l->next != nullptr) {
+			l->next->prev = r;
+		}
+		else {
+			last = r;
+		}
+		l->next = r;
+		return r;
+	}
+
+	static inner_node * split_inner(inner_node * n, T& sep) {
+		auto * r = new inner_node();
+		const auto mid = n->cnt / 2;
+		sep = std::move(n->keys[mid]);
+		for (size_t i = mid + 1; i < n->cnt; ++i) {
+			r->keys[i - mid - 1] = std::move(n->keys[i]);
+		}
+		for (size_t i = mid + 1; i <= n->cnt; ++i) {
+			r->children[i - mid - 1] = n->children[i];
+		}
+		r->cnt = n->cnt - mid - 1;
+		n->cnt = mid;
+		return r;
+	}
+
+	bool remove(node * n, const T& val) {
+		if (n->leaf) {
+			const auto pos = btree_rank(n->keys, n->cnt, val);
+			if (pos == n->cnt || !(n->keys[pos] == val)) {
+				return false;
+			}
+			for (size_t i = pos + 1; i < n->cnt; ++i) {
+				n->keys[i - 1] = std::move(n->keys[i]);
+			}
+			--n->cnt;
+			return true;
+		}
+
+		auto * in = static_cast<inner_node*>(n);
+		const auto pos = child_index(in, val);
+		if (!remove(in->children[pos], val)) {
+			return false;
+		}
+		if (in->children[pos]->cnt < min_keys) {
+			rebalance(in, pos);
+		}
+		return true;
+	}
+
+	/// refills the underfull child i of p from a sibling or merges it into one
+	void rebalance(inner_node * p, size_t i) {
+		auto * left = i > 0 ? p->children[i - 1] : nullptr;
+		auto * right = i < p->cnt ? p->children[i + 1] : nullptr;
+		if (left != nullptr && left->cnt > min_keys) {
+			borrow_left(p, i);
+		}
+		else if (right != nullptr && right->cnt > min_keys) {
+			borrow_right(p, i);
+		}
+		else if (left != nullptr) {
+			merge(p, i - 1);
+		}
+		else {
+			merge(p, i);
+		}
+	}
+
+	static void borrow_left(inner_node * p, size_t i) {
+		auto * c = p->children[i];
+		auto * left = p->children[i - 1];
+		for (size_t k = c->cnt; k > 0; --k) {
+			c->keys[k] = std::move(c->keys[k - 1]);
+		}
+		if (c->leaf) {
+			c->keys[0] = std::move(left->keys[left->cnt - 1]);
+			p->keys[i - 1] = c->keys[0];
+		}
+		else {
+			auto * ic = static_cast<inner_node*>(c);
+			auto * il = static_cast<inner_node*>(left);
+			for (size_t k = ic->cnt + 1; k > 0; --k) {
+				ic->children[k] = ic->children[k - 1];
+			}
+			ic->keys[0] = std::move(p->keys[i - 1]);
+			ic->children[0] = il->children[il->cnt];
+			p->keys[i - 1] = std::move(il->keys[il->cnt - 1]);
+		}
+		++c->cnt;
+		--left->cnt;
+	}
+
+	static void borrow_right(inner_node * p, size_t i) {
+		auto * c = p->children[i];
+		auto * right = p->children[i + 1];
+		if (c->leaf) {
+			c->keys[c->cnt] = std::move(right->keys[0]);
+			for (size_t k = 1; k < right->cnt; ++k) {
+				right->keys[k - 1] = std::move(right->keys[k]);
+			}
+			p->keys[i] = right->keys[0];
+		}
+		else {
+			auto * ic = static_cast<inner_node*>(c);
+			auto * ir = static_cast<inner_node*>(right);
+			ic->keys[ic->cnt] = std::move(p->keys[i]);
+			ic->children[ic->cnt + 1] = ir->children[0];
+			p->keys[i] = std::move(ir->keys[0]);
+			for (size_t k = 1; k < ir->cnt; ++k) {
+				ir->keys[k - 1] = std::move(ir->keys[k]);
+			}
+			for (size_t k = 1; k <= ir->cnt; ++k) {
+				ir->children[k - 1] = ir->children[k];
+			}
+		}
+		++c->cnt;
+		--right->cnt;
+	}
+
+	/// merges child i + 1 of p into child i
+	void merge(inner_node * p, size_t i) {
+		auto * l = p->children[i];
+		auto * r = p->children[i + 1];
+		if (l->leaf) {
+			for (size_t k = 0; k < r->cnt; ++k) {
+				l->keys[l->cnt + k] = std::move(r->keys[k]);
+			}
+			l->cnt += r->cnt;
+
+			auto * ll = static_cast<leaf_node*>(l);
+			auto * lr = static_cast<leaf_node*>(r);
+			ll->next = lr->next;
+			if (lr->next != nullptr) {
+				lr->next->prev = ll;
+			}
+			else {
+				last = ll;
+			}
+			delete lr;
+		}
+		else {
+			auto * il = static_cast<inner_node*>(l);
+			auto * ir = static_cast<inner_node*>(r);
+			il->keys[il->cnt] = std::move(p->keys[i]);
+			for (size_t k = 0; k < ir->cnt; ++k) {
+				il->keys[il->cnt + 1 + k] = std::move(ir->keys[k]);
+			}
+			for (size_t k = 0; k <= ir->cnt; ++k) {
+				il->children[il->cnt + 1 + k] = ir->children[k];
+			}
+			il->cnt += ir->cnt + 1;
+			delete ir;
+		}
+
+		for (size_t k = i + 1; k < p->cnt; ++k) {
+			p->keys[k - 1] = std::move(p->keys[k]);
+			p->children[k] = p->children[k + 1];
+		}
+		--p->cnt;
+	}
+
+	void build(vector_view<const T> v) {
+		cnt = v.size();
+		if (cnt == 0) {
+			return;
+		}
+
+		// spread the values evenly, so every node is at least half full
+		vector<node*> level;
+		vector<T> mins;
+		const auto leaves = (cnt + N - 1) / N;
+		size_t pos = 0;
+		leaf_node * prev = nullptr;
+		for (size_t i = 0; i < leaves; ++i) {
+			auto * l = new leaf_node();
+			l->cnt = cnt / leaves + (i < cnt % leaves ? 1 : 0);
+			for (size_t k = 0; k < l->cnt; ++k, ++pos) {
+				assert(pos == 0 || v[pos - 1] < v[pos]);
+				l->keys[k] = v[pos];
+			}
+			l->prev = prev;
+			if (prev != nullptr) {
+				prev->next = l;
+			}
+			else {
+				first = l;
+			}
+			prev = l;
+			level.push_back(l);
+			mins.push_back(l->keys[0]);
+		}
+		last = prev;
+
+		while (level.size() > 1) {
+			vector<node*> up;
+			vector<T> up_mins;
+			const auto parents = (level.size() + N) / (N + 1);
+			size_t child = 0;
+			for (size_t i = 0; i < parents; ++i) {
+				auto * in = new inner_node();
+				const auto children = level.size() / parents + (i < level.size() % parents ? 1 : 0);
+				up_mins.push_back(mins[child]);
+				in->children[0] = level[child];
+				for (size_t k = 1; k < children; ++k) {
+					in->keys[k - 1] = mins[child + k];
+					in->children[k] = level[child + k];
+				}
+				in->cnt = children - 1;
+				child += children;
+				up.push_back(in);
+			}
+			level.swap(up);
+			mins.swap(up_mins);
+		}
+		root = level[0];
+	}
+
+	node * root{nullptr};
+	leaf_node * first{nullptr};
+	leaf_node * last{nullptr};
+	size_t cnt{0};
+};
+
+template<typename T, size_t N>
+const size_t btree<T, N>::min_keys;
+
+/// ordered map on top of the B+ tree, keys are compared via pair
+template<typename K, typename V>
+class btree_map: public btree<pair<K, V>> {
+	using B = btree<pair<K, V>>;
+public:
+	using T = pair<K, V>;
+
+	btree_map() = default;
+	btree_map(const btree_map&) = default;
+	btree_map(btree_map&&) = default;
+	~btree_map() = default;
+	btree_map& operator=(const btree_map&) = default;
+	btree_map& operator=(btree_map&&) = default;
+
+	explicit btree_map(const vector<T>& sorted) : B(sorted) {}
+
+	bool insert(const K& key, const V& value) {
+		return B::insert(T(key, value));
+	}
+
+	V * find(const K& key) {
+		auto * res = B::find(T(key, V{}));
+		return res == nullptr ? nullptr : &res->second;
+	}
+
+	bool remove(const K& key) {
+		return B::remove(T(key, V{}));
+	}
+};
+
+}
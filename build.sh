@@ -1 +1,3 @@
-g++ main.cpp test.cpp -std=c++11 -ggdb2 -O0 -o main
\ No newline at end of file
+g++ main.cpp test.cpp -std=c++11 -ggdb2 -O0 -pthread -o main
+g++ main.cpp test.cpp -std=c++11 -ggdb2 -O0 -pthread -DALGO_SORT_STATS -o main_stats
+g++ bench_main.cpp bench.cpp -std=c++11 -O2 -DNDEBUG -pthread -o bench
@@ -14,3 +14,31 @@ std::unique_ptr<T> make_unique(Args&& ... args) {
 }
 
 }
+
+
+namespace algo {
+
+/// a pair of iterators usable in range-based for loops
+template<typename It>
+class iterator_range {
+public:
+	iterator_range(It b, It e) : first(b), last(e) {}
+
+	It begin() const {
+		return first;
+	}
+
+	It end() const {
+		return last;
+	}
+
+	bool empty() const {
+		return first == last;
+	}
+
+private:
+	It first;
+	It last;
+};
+
+}
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+#include "common.h"
+#include "vector.h"
+#include "pair.h"
+#include "hash_map.h"
+
+
+namespace algo {
+
+/// readers-writer spin lock that prefers writers: a writer first claims
+/// the writer bit, so no new reader gets in, then waits for the readers to leave
+class rw_spinlock {
+public:
+	rw_spinlock() = default;
+	rw_spinlock(const rw_spinlock&) = delete;
+	rw_spinlock& operator=(const rw_spinlock&) = delete;
+
+	void lock_shared() {
+		for (size_t spins = 0; ; ++spins) {
+			auto s = state.load(std::memory_order_relaxed);
+			if ((s & writer) == 0 && state.compare_exchange_weak(s, s + 1, std::memory_order_acquire)) {
+				return;
+			}
+			pause(spins);
+		}
+	}
+
+	void unlock_shared() {
+		state.fetch_sub(1, std::memory_order_release);
+	}
+
+	void lock() {
+		size_t spins = 0;
+		for (; ; ++spins) {
+			auto s = state.load(std::memory_order_relaxed);
+			if ((s & writer) == 0 && state.compare_exchange_weak(s, s | writer, std::memory_order_acquire)) {
+				break;
+			}
+			pause(spins);
+		}
+		for (; (state.load(std::memory_order_acquire) & ~writer) != 0; ++spins) {
+			pause(spins);
+		}
+	}
+
+	void unlock() {
+		state.fetch_and(~writer, std::memory_order_release);
+	}
+
+private:
+	/// spins for a while, then gives the core away in case the owner got preempted
+	static void pause(size_t spins) {
+		if (spins >= 64) {
+			std::this_thread::yield();
+			return;
+		}
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#endif
+	}
+
+	static const uint32_t writer = 1u << 31;
+
+	std::atomic<uint32_t> state{0};
+};
+
+/// hash_map shared between threads. keys are spread over Shards independent
+/// tables by the top bits of their hash and every shard has its own lock
+/// (lock striping), so threads only contend when they hit the same shard.
+/// lookups take the lock shared and copy the value out, as a pointer into
+/// the table would not survive a concurrent rehash.
+template<typename K, typename V, typename H = std::hash<K>, size_t Shards = 64>
+class concurrent_hash_map {
+	static_assert(Shards > 1 && (Shards & (Shards - 1)) == 0, "the number of shards must be a power of 2");
+
+	struct alignas(64) shard {
+		mutable rw_spinlock lock;
+		hash_map<K, V, H> map;
+	};
+
+public:
+	using T = pair<K, V>;
+
+	concurrent_hash_map() = default;
+	concurrent_hash_map(const concurrent_hash_map&) = delete;
+	concurrent_hash_map& operator=(const concurrent_hash_map&) = delete;
+
+	explicit concurrent_hash_map(const H& h) : hasher(h) {
+		for (size_t i = 0; i < Shards; ++i) {
+			shards[i].map = hash_map<K, V, H>(h);
+		}
+	}
+
+	/// false if the key is already there, its value is left untouched then
+	bool insert(const K& key, const V& value) {
+		auto& s = shard_of(key);
+		s.lock.lock();
+		const auto res = s.map.insert(key, value);
+		s.lock.unlock();
+		return res;
+	}
+
+	/// inserts or overwrites, true if the key was new
+	bool upsert(const K& key, const V& value) {
+		auto& s = shard_of(key);
+		s.lock.lock();
+		const auto res = upsert(s, key, value);
+		s.lock.unlock();
+		return res;
+	}
+
+	/// upserts a batch taking every shard lock at most once, returns the number of new keys
+	size_t upsert(vector_view<const T> batch) {
+		// counting sort of the batch by shard
+		size_t starts[Shards + 1] = {};
+		vector<size_t> shard_ids(batch.size(), 0);
+		for (size_t i = 0; i < batch.size(); ++i) {
+			shard_ids[i] = shard_index(batch[i].first);
+			++starts[shard_ids[i] + 1];
+		}
+		for (size_t i = 0; i < Shards; ++i) {
+			starts[i + 1] += starts[i];
+		}
+		size_t pos[Shards];
+		for (size_t i = 0; i < Shards; ++i) {
+			pos[i] = starts[i];
+		}
+		vector<size_t> order(batch.size(), 0);
+		for (size_t i = 0; i < batch.size(); ++i) {
+			order[pos[shard_ids[i]]++] = i;
+		}
+
+		size_t res = 0;
+		for (size_t i = 0; i < Shards; ++i) {
+			if (starts[i] == starts[i + 1]) {
+				continue;
+			}
+			auto& s = shards[i];
+			s.lock.lock();
+			s.map.reserve(s.map.size() + starts[i + 1] - starts[i]);
+			for (size_t k = starts[i]; k < starts[i + 1]; ++k) {
+				const auto& p = batch[order[k]];
+				res += upsert(s, p.first, p.second);
+			}
+			s.lock.unlock();
+		}
+		return res;
+	}
+
+	size_t upsert(const vector<T>& batch) {
+		return upsert(batch.view());
+	}
+
+	/// copies the value of key into out
+	bool find(const K& key, V& out) const {
+		const auto& s = shard_of(key);
+		s.lock.lock_shared();
+		const auto * res = s.map.find(key);
+		if (res != nullptr) {
+			out = *res;
+		}
+		s.lock.unlock_shared();
+		return res != nullptr;
+	}
+
+	bool contains(const K& key) const {
+		const auto& s = shard_of(key);
+		s.lock.lock_shared();
+		const auto res = s.map.find(key) != nullptr;
+		s.lock.unlock_shared();
+		return res;
+	}
+
+	bool remove(const K& key) {
+		auto& s = shard_of(key);
+		s.lock.lock();
+		const auto res = s.map.remove(key);
+		s.lock.unlock();
+		return res;
+	}
+
+	/// not a snapshot, other threads may change the shards while they are counted
+	size_t size() const {
+		size_t res = 0;
+		for (size_t i = 0; i < Shards; ++i) {
+			shards[i].lock.lock_shared();
+			res += shards[i].map.size();
+			shards[i].lock.unlock_shared();
+		}
+		return res;
+	}
+
+	bool empty() const {
+		return size() == 0;
+	}
+
+private:
+	static bool upsert(shard& s, const K& key, const V& value) {
+		const auto before = s.map.size();
+		s.map[key] = value;
+		return s.map.size() != before;
+	}
+
+	size_t shard_index(const K& key) const {
+		// the tables inside the shards use the low bits
+		return hash_mix(hasher(key)) >> (64 - shard_bits());
+	}
+
+	static size_t shard_bits() {
+		size_t res = 0;
+		while ((static_cast<size_t>(1) << res) < Shards) {
+			++res;
+		}
+		return res;
+	}
+
+	shard& shard_of(const K& key) {
+		return shards[shard_index(key)];
+	}
+
+	const shard& shard_of(const K& key) const {
+		return shards[shard_index(key)];
+	}
+
+	shard shards[Shards];
+	H hasher{};
+};
+
+}
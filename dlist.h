@@ -1,5 +1,6 @@
 #pragma once
 
+#include <iterator>
 #include <memory>
 
 #include "common.h"
@@ -31,6 +32,69 @@ public:
 		node * prev{nullptr};
 	};
 
+	template<typename V, typename N>
+	class basic_iterator {
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = V*;
+		using reference = V&;
+
+		basic_iterator() = default;
+		basic_iterator(N * n, const dlist * o) : cur(n), owner(o) {}
+
+		operator basic_iterator<const V, const N>() const {
+			return basic_iterator<const V, const N>(cur, owner);
+		}
+
+		reference operator*() const {
+			return cur->val;
+		}
+
+		pointer operator->() const {
+			return &cur->val;
+		}
+
+		basic_iterator& operator++() {
+			cur = cur->next.get();
+			return *this;
+		}
+
+		basic_iterator operator++(int) {
+			auto res = *this;
+			++*this;
+			return res;
+		}
+
+		/// end() steps back to the last element
+		basic_iterator& operator--() {
+			cur = cur == nullptr ? owner->last : cur->prev;
+			return *this;
+		}
+
+		basic_iterator operator--(int) {
+			auto res = *this;
+			--*this;
+			return res;
+		}
+
+		bool operator==(const basic_iterator& r) const {
+			return cur == r.cur;
+		}
+
+		bool operator!=(const basic_iterator& r) const {
+			return !(*this == r);
+		}
+
+	private:
+		N * cur{nullptr};
+		const dlist * owner{nullptr};
+	};
+
+	using iterator = basic_iterator<T, node>;
+	using const_iterator = basic_iterator<const T, const node>;
+
 	dlist() = default;
 
 	dlist(const dlist& r) {
@@ -139,6 +203,22 @@ public:
 		return last->val;
 	}
 
+	iterator begin() {
+		return iterator(head.get(), this);
+	}
+
+	iterator end() {
+		return iterator(nullptr, this);
+	}
+
+	const_iterator begin() const {
+		return const_iterator(head.get(), this);
+	}
+
+	const_iterator end() const {
+		return const_iterator(nullptr, this);
+	}
+
 	const T& operator[](size_t n) const {
 		assert(n < len);
 		const auto * tmp = head.get();
@@ -0,0 +1,420 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdio>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "vector.h"
+#include "vector_view.h"
+#include "merge.h"
+#include "sort.h"
+
+
+namespace algo {
+
+/// what an external sort did: a pass reads and writes every record once
+struct external_sort_stats {
+	size_t records{0};
+	size_t runs{0};
+	size_t passes{0};
+	size_t bytes_read{0};
+	size_t bytes_written{0};
+};
+
+/// a file descriptor that is closed on destruction
+class file_handle {
+public:
+	file_handle() = default;
+	explicit file_handle(int f) : fd(f) {}
+	file_handle(const file_handle&) = delete;
+	file_handle& operator=(const file_handle&) = delete;
+
+	file_handle(file_handle&& r) : fd(r.fd) {
+		r.fd = -1;
+	}
+
+	file_handle& operator=(file_handle&& r) {
+		std::swap(fd, r.fd);
+		return *this;
+	}
+
+	~file_handle() {
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+
+	int get() const {
+		return fd;
+	}
+
+	bool valid() const {
+		return fd >= 0;
+	}
+
+private:
+	int fd{-1};
+};
+
+/// an unnamed file in dir, it disappears once the handle is closed
+inline file_handle temp_file(const char * dir) {
+	char path[4096];
+	if (snprintf(path, sizeof(path), "%s/algo_sort_XXXXXX", dir) >= static_cast<int>(sizeof(path))) {
+		return file_handle();
+	}
+	file_handle res(mkstemp(path));
+	if (res.valid()) {
+		unlink(path);
+	}
+	return res;
+}
+
+/// the file external_sort writes out_path through. if out_path is the input, that
+/// is a file next to it which replaces it once the output is complete, so the input
+/// is not truncated while it is read. a file that is not committed is removed.
+class sort_output {
+public:
+	sort_output() = default;
+	sort_output(const sort_output&) = delete;
+	sort_output& operator=(const sort_output&) = delete;
+
+	~sort_output() {
+		if (temp[0] != '\0') {
+			unlink(temp);
+		}
+	}
+
+	/// opens path truncated, or a file next to it if it is the file of in
+	bool open(const char * path, const struct stat& in) {
+		struct stat st;
+		if (stat(path, &st) != 0 || st.st_dev != in.st_dev || st.st_ino != in.st_ino) {
+			fd = file_handle(::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644));
+			return fd.valid();
+		}
+		if (snprintf(temp, sizeof(temp), "%s.algo_sort_XXXXXX", path) >= static_cast<int>(sizeof(temp))) {
+			temp[0] = '\0';
+			return false;
+		}
+		fd = file_handle(mkstemp(temp));
+		if (!fd.valid()) {
+			temp[0] = '\0';
+			return false;
+		}
+		target = path;
+		return fchmod(fd.get(), in.st_mode & 07777) == 0;
+	}
+
+	/// renames the file next to the target over it, if there is one
+	bool commit() {
+		if (temp[0] == '\0') {
+			return true;
+		}
+		if (rename(temp, target) != 0) {
+			return false;
+		}
+		temp[0] = '\0';
+		return true;
+	}
+
+	int get() const {
+		return fd.get();
+	}
+
+private:
+	file_handle fd{};
+	char temp[4096] = "";
+	const char * target{nullptr};
+};
+
+inline bool pread_all(int fd, void * buf, size_t n, size_t offset) {
+	auto * p = static_cast<char*>(buf);
+	while (n > 0) {
+		const auto r = pread(fd, p, n, offset);
+		if (r < 0 && errno == EINTR) {
+			continue;
+		}
+		if (r <= 0) {
+			return false;
+		}
+		p += r;
+		n -= r;
+		offset += r;
+	}
+	return true;
+}
+
+inline bool pwrite_all(int fd, const void * buf, size_t n, size_t offset) {
+	const auto * p = static_cast<const char*>(buf);
+	while (n > 0) {
+		const auto r = pwrite(fd, p, n, offset);
+		if (r < 0 && errno == EINTR) {
+			continue;
+		}
+		if (r <= 0) {
+			return false;
+		}
+		p += r;
+		n -= r;
+		offset += r;
+	}
+	return true;
+}
+
+/// a sorted run of records in a file, offset and count are in records
+struct external_run {
+	external_run() = default;
+	external_run(size_t o, size_t c) : offset(o), count(c) {}
+
+	size_t offset{0};
+	size_t count{0};
+};
+
+/// appends records to a file through a buffer of the given number of records
+template<typename T>
+class run_writer {
+public:
+	run_writer(int f, size_t offset, size_t records, external_sort_stats& s) :
+		fd(f), pos(offset), buf(records, T{}), stats(&s) {}
+
+	void push(const T& val) {
+		buf[len] = val;
+		++len;
+		if (len == buf.size()) {
+			flush();
+		}
+	}
+
+	/// writes records straight from memory, bypassing the buffer
+	void write(vector_view<const T> v) {
+		flush();
+		store(v.data(), v.size());
+	}
+
+	void flush() {
+		store(buf.data(), len);
+		len = 0;
+	}
+
+	/// the record the next push goes to
+	size_t offset() const {
+		return pos + len;
+	}
+
+	bool good() const {
+		return ok;
+	}
+
+private:
+	void store(const T * p, size_t n) {
+		const auto bytes = n * sizeof(T);
+		ok = ok && pwrite_all(fd, p, bytes, pos * sizeof(T));
+		stats->bytes_written += bytes;
+		pos += n;
+	}
+
+	int fd;
+	size_t pos;
+	vector<T> buf;
+	size_t len{0};
+	bool ok{true};
+	external_sort_stats * stats;
+};
+
+/// reads one run of a file sequentially through a buffer of the given number of records
+template<typename T>
+class run_reader {
+public:
+	run_reader() = default;
+
+	run_reader(int f, external_run run, size_t records, external_sort_stats& s) :
+		fd(f), pos(run.offset), left(run.count), buf(records, T{}), stats(&s) {
+		fill();
+	}
+
+	bool empty() const {
+		return cur == len;
+	}
+
+	const T& front() const {
+		assert(!empty());
+		return buf[cur];
+	}
+
+	void pop() {
+		assert(!empty());
+		++cur;
+		if (cur == len) {
+			fill();
+		}
+	}
+
+	bool good() const {
+		return ok;
+	}
+
+private:
+	void fill() {
+		const auto n = left < buf.size() ? left : buf.size();
+		const auto bytes = n * sizeof(T);
+		ok = ok && pread_all(fd, buf.data(), bytes, pos * sizeof(T));
+		stats->bytes_read += bytes;
+		pos += n;
+		left -= n;
+		cur = 0;
+		len = ok ? n : 0;
+	}
+
+	int fd{-1};
+	size_t pos{0};
+	size_t left{0};
+	vector<T> buf{};
+	size_t cur{0};
+	size_t len{0};
+	bool ok{true};
+	external_sort_stats * stats{nullptr};
+};
+
+/// merges the sorted runs of src into out using about records records of memory
+template<typename T>
+bool merge_runs(int src, vector_view<const external_run> runs, run_writer<T>& out, size_t records, external_sort_stats& stats) {
+	vector<run_reader<T>> readers;
+	readers.reserve(runs.size());
+	loser_tree<T> tree(runs.size());
+	const auto block = records / runs.size();
+	for (size_t i = 0; i < runs.size(); ++i) {
+		readers.push_back(run_reader<T>(src, runs[i], block, stats));
+		if (!readers[i].empty()) {
+			tree.reset(i, readers[i].front());
+		}
+	}
+	tree.build();
+	while (!tree.empty()) {
+		out.push(tree.min());
+		auto& r = readers[tree.top()];
+		r.pop();
+		if (!r.empty()) {
+			tree.replace(r.front());
+		}
+		else {
+			tree.pop();
+		}
+	}
+	for (size_t i = 0; i < readers.size(); ++i) {
+		if (!readers[i].good()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/// sorts a binary file of fixed width records T into out_path using about
+/// memory_bytes of memory, temporary runs go to unnamed files in tmp_dir.
+/// the input is mapped copy on write and sorted in place one memory sized chunk
+/// at a time, every chunk becomes a sorted run. runs are then merged by a loser_tree
+/// as many at a time as the memory allows, with large sequential reads and writes,
+/// until one is left. out_path may be in_path, then the sorted file replaces it.
+/// false on any I/O error or if the file size is not a multiple of sizeof(T).
+template<typename T>
+bool external_sort(const char * in_path, const char * out_path, size_t memory_bytes, external_sort_stats& stats, const char * tmp_dir = "/tmp") {
+	static_assert(std::is_trivially_copyable<T>::value, "records are copied to and from files as bytes");
+	stats = external_sort_stats();
+	file_handle in(open(in_path, O_RDONLY));
+	struct stat st;
+	if (!in.valid() || fstat(in.get(), &st) != 0 || st.st_size % sizeof(T) != 0) {
+		return false;
+	}
+	// the output is opened once the input is read, it may be the input
+	sort_output out;
+	const size_t n = st.st_size / sizeof(T);
+	stats.records = n;
+	if (n == 0) {
+		return out.open(out_path, st) && out.commit();
+	}
+
+	// a merge wants buffers of at least 64KiB, but always merges at least 2 runs
+	const auto records = std::max<size_t>(memory_bytes / sizeof(T), 4);
+	const auto block = std::min(std::max<size_t>((64 << 10) / sizeof(T), 1), records / 3);
+	const auto fan_in = std::max<size_t>(records / block - 1, 2);
+
+	// pass 1: sorted runs, a single one goes to the output
+	vector<external_run> runs;
+	file_handle cur = n <= records ? file_handle() : temp_file(tmp_dir);
+	if (n > records && !cur.valid()) {
+		return false;
+	}
+	{
+		auto * map = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, in.get(), 0);
+		if (map == MAP_FAILED) {
+			return false;
+		}
+		madvise(map, st.st_size, MADV_SEQUENTIAL);
+		vector_view<T> input(static_cast<T*>(map), n);
+		const size_t page = sysconf(_SC_PAGESIZE);
+		size_t offset = 0;
+		for (size_t from = 0; from < n; from += records) {
+			auto chunk = input.view(from, std::min(from + records, n));
+			intro_sort(chunk);
+			stats.bytes_read += chunk.size() * sizeof(T);
+			if (!cur.valid() && !out.open(out_path, st)) {
+				munmap(map, st.st_size);
+				return false;
+			}
+			run_writer<T> w(cur.valid() ? cur.get() : out.get(), offset, 0, stats);
+			runs.push_back(external_run(offset, chunk.size()));
+			w.write(chunk);
+			if (!w.good()) {
+				munmap(map, st.st_size);
+				return false;
+			}
+			offset = w.offset();
+			// the sorted private copies are written, give their memory back
+			const auto first = (from * sizeof(T) + page - 1) / page * page;
+			const auto end = (from + chunk.size()) * sizeof(T) / page * page;
+			if (first < end) {
+				madvise(static_cast<char*>(map) + first, end - first, MADV_DONTNEED);
+			}
+		}
+		munmap(map, st.st_size);
+	}
+	if (cur.valid() && !out.open(out_path, st)) {
+		return false;
+	}
+	stats.runs = runs.size();
+	stats.passes = 1;
+
+	// merge passes, the last one writes the output
+	while (runs.size() > 1) {
+		const auto last = runs.size() <= fan_in;
+		file_handle next = last ? file_handle() : temp_file(tmp_dir);
+		if (!last && !next.valid()) {
+			return false;
+		}
+		const auto k = std::min(runs.size(), fan_in);
+		run_writer<T> w(last ? out.get() : next.get(), 0, records / (k + 1), stats);
+		vector<external_run> merged;
+		for (size_t i = 0; i < runs.size(); i += fan_in) {
+			const auto group = runs.view(i, std::min(i + fan_in, runs.size()));
+			const auto offset = w.offset();
+			if (!merge_runs<T>(cur.get(), group, w, records - records / (k + 1), stats)) {
+				return false;
+			}
+			merged.push_back(external_run(offset, w.offset() - offset));
+		}
+		w.flush();
+		if (!w.good()) {
+			return false;
+		}
+		runs = std::move(merged);
+		cur = std::move(next);
+		++stats.passes;
+	}
+	return out.commit();
+}
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstring>
+
+#include "common.h"
+
+
+namespace algo {
+
+/// a string of exactly N chars, shorter strings are padded with zeros.
+/// compares by unsigned chars like memcmp, so it sorts like the padded strings.
+template<size_t N>
+struct fixed_string {
+	fixed_string() = default;
+	fixed_string(const fixed_string&) = default;
+	fixed_string(fixed_string&&) = default;
+	~fixed_string() = default;
+	fixed_string& operator=(const fixed_string&) = default;
+	fixed_string& operator=(fixed_string&&) = default;
+
+	/// the first N chars of s
+	explicit fixed_string(const char * s) {
+		for (size_t i = 0; i < N && s[i] != 0; ++i) {
+			chars[i] = s[i];
+		}
+	}
+
+	bool operator==(const fixed_string& r) const {
+		return memcmp(chars, r.chars, N) == 0;
+	}
+
+	bool operator!=(const fixed_string& r) const {
+		return !(*this == r);
+	}
+
+	bool operator<(const fixed_string& r) const {
+		return memcmp(chars, r.chars, N) < 0;
+	}
+
+	bool operator>(const fixed_string& r) const {
+		return r < *this;
+	}
+
+	char chars[N]{};
+};
+
+}
@@ -0,0 +1,412 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iterator>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "common.h"
+#include "pair.h"
+
+
+namespace algo {
+
+/// final mixing step of murmur3, spreads weak hashes (std::hash of an int is
+/// the int itself) over all bits, because the table takes bits from both ends
+inline uint64_t hash_mix(uint64_t h) {
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/// 16 control bytes of a swiss table group: empty, deleted or the low 7 bits of a full slot's hash
+class hash_group {
+public:
+	static const size_t width = 16;
+	static const int8_t empty = -128;
+	static const int8_t deleted = -2;
+
+	explicit hash_group(const int8_t * c) : ctrl(c) {}
+
+	/// bit i is set when ctrl[i] == b
+	uint32_t match(int8_t b) const {
+#ifdef __SSE2__
+		const auto g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+		return _mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(b)));
+#else
+		uint32_t res = 0;
+		for (size_t i = 0; i < width; ++i) {
+			res |= static_cast<uint32_t>(ctrl[i] == b) << i;
+		}
+		return res;
+#endif
+	}
+
+	uint32_t match_empty() const {
+		return match(empty);
+	}
+
+	/// empty and deleted bytes are the only negative ones
+	uint32_t match_free() const {
+#ifdef __SSE2__
+		const auto g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+		return _mm_movemask_epi8(g);
+#else
+		uint32_t res = 0;
+		for (size_t i = 0; i < width; ++i) {
+			res |= static_cast<uint32_t>(ctrl[i] < 0) << i;
+		}
+		return res;
+#endif
+	}
+
+private:
+	const int8_t * ctrl;
+};
+
+/// flat open addressing hash set (swiss table): values live inline in one array,
+/// a parallel array of control bytes is probed 16 slots at a time with SIMD
+/// and the values are only compared when 7 bits of their hash match.
+template<typename T, typename H = std::hash<T>>
+class hash_set {
+public:
+	using type = T;
+
+	class iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const T*;
+		using reference = const T&;
+
+		iterator() = default;
+		iterator(const hash_set * s, size_t i) : set(s), idx(i) {
+			skip();
+		}
+
+		reference operator*() const {
+			return set->slots[idx];
+		}
+
+		pointer operator->() const {
+			return &set->slots[idx];
+		}
+
+		iterator& operator++() {
+			++idx;
+			skip();
+			return *this;
+		}
+
+		iterator operator++(int) {
+			auto res = *this;
+			++*this;
+			return res;
+		}
+
+		bool operator==(const iterator& r) const {
+			return idx == r.idx;
+		}
+
+		bool operator!=(const iterator& r) const {
+			return !(*this == r);
+		}
+
+	private:
+		void skip() {
+			while (idx < set->cap && set->ctrl[idx] < 0) {
+				++idx;
+			}
+		}
+
+		const hash_set * set{nullptr};
+		size_t idx{0};
+	};
+
+	hash_set() = default;
+
+	explicit hash_set(const H& h) : hasher(h) {}
+
+	hash_set(const hash_set& r) : hasher(r.hasher) {
+		reserve(r.size());
+		for (const auto& v : r) {
+			insert(v);
+		}
+	}
+
+	hash_set(hash_set&& r) {
+		swap(r);
+	}
+
+	~hash_set() {
+		drop();
+	}
+
+	hash_set& operator=(const hash_set& r) {
+		hash_set tmp(r);
+		swap(tmp);
+		return *this;
+	}
+
+	hash_set& operator=(hash_set&& r) {
+		swap(r);
+		return *this;
+	}
+
+	size_t size() const {
+		return cnt;
+	}
+
+	bool empty() const {
+		return cnt == 0;
+	}
+
+	size_t capacity() const {
+		return cap;
+	}
+
+	iterator begin() const {
+		return iterator(this, 0);
+	}
+
+	iterator end() const {
+		return iterator(this, cap);
+	}
+
+	void swap(hash_set& r) {
+		using std::swap;
+		swap(ctrl, r.ctrl);
+		swap(slots, r.slots);
+		swap(cap, r.cap);
+		swap(cnt, r.cnt);
+		swap(growth_left, r.growth_left);
+		swap(hasher, r.hasher);
+	}
+
+	T * find(const T& val) {
+		const auto i = find_index(val);
+		return i == cap ? nullptr : &slots[i];
+	}
+
+	const T * find(const T& val) const {
+		const auto i = find_index(val);
+		return i == cap ? nullptr : &slots[i];
+	}
+
+	bool contains(const T& val) const {
+		return find_index(val) != cap;
+	}
+
+	bool insert(const T& val) {
+		return insert_slot(val).second;
+	}
+
+	bool remove(const T& val) {
+		const auto i = find_index(val);
+		if (i == cap) {
+			return false;
+		}
+		// a group that still has an empty slot never made a probe go on,
+		// so the slot can become empty instead of a tombstone
+		const auto g = i - i % hash_group::width;
+		if (hash_group(ctrl + g).match_empty() != 0) {
+			ctrl[i] = hash_group::empty;
+			++growth_left;
+		}
+		else {
+			ctrl[i] = hash_group::deleted;
+		}
+		slots[i] = T{}; // delete
+		--cnt;
+		return true;
+	}
+
+	void clear() {
+		drop();
+		ctrl = nullptr;
+		slots = nullptr;
+		cap = cnt = growth_left = 0;
+	}
+
+	/// makes room for n values without a rehash
+	void reserve(size_t n) {
+		if (n <= cnt + growth_left) {
+			return;
+		}
+		size_t c = hash_group::width;
+		while (max_load(c) < n) {
+			c *= 2;
+		}
+		rehash(c);
+	}
+
+	/// rebuilds the table with capacity c, a power of 2, dropping all tombstones
+	void rehash(size_t c) {
+		assert(c % hash_group::width == 0 && (c & (c - 1)) == 0);
+		assert(max_load(c) >= cnt);
+		hash_set tmp(hasher);
+		tmp.alloc(c);
+		for (size_t i = 0; i < cap; ++i) {
+			if (ctrl[i] >= 0) {
+				tmp.insert_new(std::move(slots[i]));
+			}
+		}
+		swap(tmp);
+	}
+
+protected:
+	/// the slot of val, inserted if it was not there, and whether it was inserted
+	pair<T*, bool> insert_slot(const T& val) {
+		const auto i = find_index(val);
+		if (i != cap) {
+			return pair<T*, bool>(&slots[i], false);
+		}
+		if (growth_left == 0) {
+			rehash(cap == 0 ? hash_group::width : (max_load(cap) / 2 < cnt ? cap * 2 : cap));
+		}
+		return pair<T*, bool>(&slots[insert_new(val)], true);
+	}
+
+private:
+	/// 7/8 maximal load factor
+	static size_t max_load(size_t c) {
+		return c - c / 8;
+	}
+
+	uint64_t hash(const T& val) const {
+		return hash_mix(hasher(val));
+	}
+
+	size_t groups_mask() const {
+		return cap / hash_group::width - 1;
+	}
+
+	size_t find_index(const T& val) const {
+		if (cap == 0) {
+			return cap;
+		}
+		const auto h = hash(val);
+		const auto h2 = static_cast<int8_t>(h & 0x7f);
+		auto g = (h >> 7) & groups_mask();
+		for (size_t step = 1; ; ++step) {
+			const auto * c = ctrl + g * hash_group::width;
+			const auto * s = slots + g * hash_group::width;
+			const hash_group group(c);
+			for (auto m = group.match(h2); m != 0; m &= m - 1) {
+				const auto i = __builtin_ctz(m);
+				if (s[i] == val) {
+					return g * hash_group::width + i;
+				}
+			}
+			if (group.match_empty() != 0) {
+				return cap;
+			}
+			// triangular steps visit every group of a power of 2 table
+			g = (g + step) & groups_mask();
+		}
+	}
+
+	/// puts a value that is not in the table into the first free slot of its probe sequence
+	template<typename V>
+	size_t insert_new(V&& val) {
+		const auto h = hash(val);
+		auto g = (h >> 7) & groups_mask();
+		for (size_t step = 1; ; ++step) {
+			const auto m = hash_group(ctrl + g * hash_group::width).match_free();
+			if (m != 0) {
+				const auto i = g * hash_group::width + __builtin_ctz(m);
+				if (ctrl[i] == hash_group::empty) {
+					--growth_left;
+				}
+				ctrl[i] = static_cast<int8_t>(h & 0x7f);
+				slots[i] = std::forward<V>(val);
+				++cnt;
+				return i;
+			}
+			g = (g + step) & groups_mask();
+		}
+	}
+
+	void alloc(size_t c) {
+		ctrl = new int8_t[c];
+		for (size_t i = 0; i < c; ++i) {
+			ctrl[i] = hash_group::empty;
+		}
+		slots = new T[c];
+		cap = c;
+		growth_left = max_load(c);
+	}
+
+	void drop() {
+		delete [] ctrl;
+		delete [] slots;
+	}
+
+	int8_t * ctrl{nullptr};
+	T * slots{nullptr};
+	size_t cap{0};
+	size_t cnt{0};
+	size_t growth_left{0};
+	H hasher{};
+};
+
+/// hashes a pair by its key only, like pair compares by its key only
+template<typename K, typename V, typename H>
+struct pair_key_hash {
+	pair_key_hash() = default;
+	explicit pair_key_hash(const H& h) : hasher(h) {}
+
+	size_t operator()(const pair<K, V>& p) const {
+		return hasher(p.first);
+	}
+
+	H hasher{};
+};
+
+template<typename K, typename V, typename H = std::hash<K>>
+class hash_map: public hash_set<pair<K, V>, pair_key_hash<K, V, H>> {
+	using B = hash_set<pair<K, V>, pair_key_hash<K, V, H>>;
+public:
+	using T = pair<K, V>;
+
+	hash_map() = default;
+	hash_map(const hash_map&) = default;
+	hash_map(hash_map&&) = default;
+	~hash_map() = default;
+	hash_map& operator=(const hash_map&) = default;
+	hash_map& operator=(hash_map&&) = default;
+
+	explicit hash_map(const H& h) : B(pair_key_hash<K, V, H>(h)) {}
+
+	/// false if the key is already there, its value is left untouched then
+	bool insert(const K& key, const V& value) {
+		return B::insert(T(key, value));
+	}
+
+	V * find(const K& key) {
+		auto * res = B::find(T(key, V{}));
+		return res == nullptr ? nullptr : &res->second;
+	}
+
+	const V * find(const K& key) const {
+		const auto * res = B::find(T(key, V{}));
+		return res == nullptr ? nullptr : &res->second;
+	}
+
+	bool remove(const K& key) {
+		return B::remove(T(key, V{}));
+	}
+
+	V& operator[](const K& key) {
+		return B::insert_slot(T(key, V{})).first->second;
+	}
+};
+
+}
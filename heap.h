@@ -21,7 +21,7 @@ public:
 	heap& operator=(const heap&) = default;
 	heap& operator=(heap&&) = default;
 
-	explicit heap(const vector_view<T>& v) : data(v) {
+	explicit heap(vector_view<const T> v) : data(v) {
 		for (int i = v.size() / 2; i >= 0; --i) {
 			heapify(i);
 		}
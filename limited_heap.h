@@ -24,7 +24,7 @@ public:
 	limited_heap& operator=(limited_heap&&) = default;
 
 	explicit limited_heap(size_t n) : N(n) {}
-	explicit limited_heap(size_t n, const vector_view<T>& v) : N(n), data(v) {}
+	explicit limited_heap(size_t n, vector_view<const T> v) : N(n), data(v) {}
 	explicit limited_heap(const vector<T>& v) : limited_heap(v.view()) {}
 
 	T pop_max() {
@@ -101,7 +101,7 @@ public:
 	limited_heap& operator=(limited_heap&&) = default;
 
 	explicit limited_heap(size_t n) : N(n) {}
-	explicit limited_heap(size_t n, const vector_view<T>& v) : N(n), data(v) {}
+	explicit limited_heap(size_t n, vector_view<const T> v) : N(n), data(v) {}
 	explicit limited_heap(const vector<T>& v) : limited_heap(v.view()) {}
 
 	T pop_max() {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <iterator>
 #include <memory>
 
 #include "common.h"
@@ -29,6 +30,56 @@ public:
 		std::unique_ptr<node> next{};
 	};
 
+	template<typename V, typename N>
+	class basic_iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = V*;
+		using reference = V&;
+
+		basic_iterator() = default;
+		explicit basic_iterator(N * n) : cur(n) {}
+
+		operator basic_iterator<const V, const N>() const {
+			return basic_iterator<const V, const N>(cur);
+		}
+
+		reference operator*() const {
+			return cur->val;
+		}
+
+		pointer operator->() const {
+			return &cur->val;
+		}
+
+		basic_iterator& operator++() {
+			cur = cur->next.get();
+			return *this;
+		}
+
+		basic_iterator operator++(int) {
+			auto res = *this;
+			++*this;
+			return res;
+		}
+
+		bool operator==(const basic_iterator& r) const {
+			return cur == r.cur;
+		}
+
+		bool operator!=(const basic_iterator& r) const {
+			return !(*this == r);
+		}
+
+	private:
+		N * cur{nullptr};
+	};
+
+	using iterator = basic_iterator<T, node>;
+	using const_iterator = basic_iterator<const T, const node>;
+
 	list() = default;
 
 	list(const list& r) {
@@ -99,6 +150,22 @@ public:
 		return head->val;
 	}
 
+	iterator begin() {
+		return iterator(head.get());
+	}
+
+	iterator end() {
+		return iterator();
+	}
+
+	const_iterator begin() const {
+		return const_iterator(head.get());
+	}
+
+	const_iterator end() const {
+		return const_iterator();
+	}
+
 	const T& operator[](size_t n) const {
 		assert(n < len);
 		const auto * tmp = head.get();
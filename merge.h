@@ -0,0 +1,373 @@
+#pragma once
+
+#include <type_traits>
+
+#include "common.h"
+#include "vector.h"
+#include "vector_view.h"
+#include "sort_stats.h"
+#include "pair.h"
+#include "search.h"
+#include "sort.h"
+#include "parallel.h"
+
+
+namespace algo {
+
+/// tournament tree of k sources that remembers the loser of every match:
+/// the smallest head is at the root and replacing it replays only the
+/// matches on its path to the root, log2 k comparisons, where a heap needs
+/// about 2 log2 k. leaves are the sources k..2k-1 of a heap shaped tree and
+/// every inner node keeps the key of its loser, so a replay reads one node per level.
+/// exhausted sources lose every match, so no sentinel value is needed,
+/// and ties go to the lower source, so merges are stable.
+template<typename T>
+class loser_tree {
+public:
+	using type = T;
+
+	loser_tree() = default;
+	loser_tree(const loser_tree&) = default;
+	loser_tree(loser_tree&&) = default;
+	~loser_tree() = default;
+	loser_tree& operator=(const loser_tree&) = default;
+	loser_tree& operator=(loser_tree&&) = default;
+
+	/// k exhausted sources, give them heads with reset then call build
+	explicit loser_tree(size_t k) : nodes(k, node()) {
+		for (size_t i = 0; i < k; ++i) {
+			nodes[i].src = i | exhausted;
+		}
+	}
+
+	size_t size() const {
+		return nodes.size();
+	}
+
+	void reset(size_t src, const T& key) {
+		nodes[src].key = key;
+		nodes[src].src = src;
+	}
+
+	/// plays all matches, O(k)
+	void build() {
+		const auto k = size();
+		if (k == 0) {
+			return;
+		}
+		// the sources, until then in nodes[0, k), become the leaves of the winners tree
+		vector<node> winners(2 * k, node());
+		for (size_t i = 0; i < k; ++i) {
+			winners[k + i] = nodes[i];
+		}
+		for (size_t n = k - 1; n > 0; --n) {
+			const auto& a = winners[2 * n];
+			const auto& b = winners[2 * n + 1];
+			const auto a_wins = less(a.key, a.src, b.key, b.src);
+			nodes[n] = a_wins ? b : a;
+			winners[n] = a_wins ? a : b;
+		}
+		nodes[0] = winners[1];
+	}
+
+	/// true when every source is exhausted
+	bool empty() const {
+		return size() == 0 || (nodes[0].src & exhausted) != 0;
+	}
+
+	/// the source of the smallest head
+	size_t top() const {
+		return nodes[0].src & ~exhausted;
+	}
+
+	const T& min() const {
+		assert(!empty());
+		return nodes[0].key;
+	}
+
+	/// the winner's source moved on to key
+	void replace(const T& key) {
+		replay(key, nodes[0].src);
+	}
+
+	/// the winner's source is exhausted
+	void pop() {
+		replay(nodes[0].key, nodes[0].src | exhausted);
+	}
+
+private:
+	static const size_t exhausted = static_cast<size_t>(1) << (8 * sizeof(size_t) - 1);
+
+	using integral_key = std::integral_constant<bool, std::is_integral<T>::value && !std::is_same<T, bool>::value>;
+
+	struct node {
+		T key{};
+		size_t src{exhausted};
+	};
+
+	/// (key, src) order where exhausted sources come last
+	static bool less(const T& a, size_t as, const T& b, size_t bs) {
+		if (((as | bs) & exhausted) != 0) {
+			return as < bs;
+		}
+		return (a < b) | (!(b < a) & (as < bs));
+	}
+
+	/// c ? a : b without a branch, which side wins a match is a coin flip on
+	/// random input. compilers turn a plain ?: back into a jump.
+	static T pick(bool c, const T& a, const T& b, std::true_type) {
+		const auto m = static_cast<T>(-static_cast<typename std::make_unsigned<T>::type>(c));
+		return b ^ ((a ^ b) & m);
+	}
+
+	static T pick(bool c, const T& a, const T& b, std::false_type) {
+		const T both[2] = {b, a};
+		return both[c];
+	}
+
+	void replay(T key, size_t src) {
+		auto * arr = nodes.data();
+		for (auto n = ((src & ~exhausted) + size()) / 2; n > 0; n /= 2) {
+			auto& l = arr[n];
+			const auto lkey = l.key;
+			const auto lsrc = l.src;
+			const auto up = less(lkey, lsrc, key, src);
+			const auto m = -static_cast<size_t>(up);
+			l.key = pick(up, key, lkey, integral_key());
+			key = pick(up, lkey, key, integral_key());
+			l.src = lsrc ^ ((lsrc ^ src) & m);
+			src = src ^ ((lsrc ^ src) & m);
+		}
+		arr[0].key = key;
+		arr[0].src = src;
+	}
+
+	/// nodes[0] is the overall winner, the others the losers of their match
+	vector<node> nodes{};
+};
+
+template<typename T>
+const size_t loser_tree<T>::exhausted;
+
+/// merges the sorted inputs into out, which has room for all of them.
+/// equal elements keep the order of their inputs.
+template<typename T>
+void multiway_merge(const_view_t<vector_view<const T>> inputs, vector_view<T> out) {
+	const auto k = inputs.size();
+	vector<size_t> pos(k, 0);
+	loser_tree<T> tree(k);
+	for (size_t i = 0; i < k; ++i) {
+		if (!inputs[i].empty()) {
+			tree.reset(i, inputs[i][0]);
+		}
+	}
+	tree.build();
+	size_t cnt = 0;
+	while (!tree.empty()) {
+		const auto src = tree.top();
+		out[cnt] = tree.min();
+		++cnt;
+		const auto next = ++pos[src];
+		if (next < inputs[src].size()) {
+			tree.replace(inputs[src][next]);
+		}
+		else {
+			tree.pop();
+		}
+	}
+	assert(cnt == out.size());
+}
+
+template<typename T>
+void multiway_merge(const vector<vector_view<const T>>& inputs, vector<T>& out) {
+	size_t total = 0;
+	for (size_t i = 0; i < inputs.size(); ++i) {
+		total += inputs[i].size();
+	}
+	out = vector<T>(total, T{});
+	multiway_merge(inputs.view(), out.view());
+}
+
+
+/// the number of the first k elements of the stable merge of l and r that come from l,
+/// a binary search along the merge path
+template<typename T>
+size_t co_rank(vector_view<const T> l, vector_view<const T> r, size_t k) {
+	assert(k <= l.size() + r.size());
+	size_t lo = k > r.size() ? k - r.size() : 0;
+	size_t hi = k < l.size() ? k : l.size();
+	while (lo < hi) {
+		const auto i = lo + (hi - lo) / 2;
+		const auto j = k - i;
+		// l[i] goes before r[j - 1], so more than i elements come from l
+		if (i < l.size() && j > 0 && !(r[j - 1] < l[i])) {
+			lo = i + 1;
+		}
+		else {
+			hi = i;
+		}
+	}
+	return lo;
+}
+
+/// co_rank for many inputs: pos[i] elements of inputs[i] are among the first k
+/// elements of their stable merge. the element of rank k is found by a binary
+/// search in every input, each step counts its rank with a binary search in every input,
+/// so it takes O(m^2 log^2 n) for m inputs.
+template<typename T>
+void multiway_co_rank(vector_view<const vector_view<const T>> inputs, size_t k, vector_view<size_t> pos) {
+	const auto m = inputs.size();
+	assert(pos.size() == m);
+	size_t total = 0;
+	for (size_t i = 0; i < m; ++i) {
+		total += inputs[i].size();
+	}
+	assert(k <= total);
+	if (k == total) {
+		for (size_t i = 0; i < m; ++i) {
+			pos[i] = inputs[i].size();
+		}
+		return;
+	}
+
+	// the number of elements before inputs[j][p] in the merge, ties go to lower inputs
+	const auto rank = [&](size_t j, size_t p) {
+		const auto& val = inputs[j][p];
+		size_t res = 0;
+		for (size_t i = 0; i < m; ++i) {
+			const auto in = inputs[i];
+			if (i == j) {
+				pos[i] = p;
+			}
+			else {
+				const auto * b = i < j ? upper_bound(in, val) : lower_bound(in, val);
+				pos[i] = b - in.data();
+			}
+			res += pos[i];
+		}
+		return res;
+	};
+	for (size_t j = 0; j < m; ++j) {
+		size_t lo = 0;
+		size_t hi = inputs[j].size();
+		while (lo < hi) {
+			const auto p = lo + (hi - lo) / 2;
+			const auto r = rank(j, p);
+			if (r < k) {
+				lo = p + 1;
+			}
+			else if (r > k) {
+				hi = p;
+			}
+			else {
+				return;
+			}
+		}
+	}
+	assert(false);
+}
+
+template<typename T>
+void multiway_co_rank(const vector<vector_view<const T>>& inputs, size_t k, vector<size_t>& pos) {
+	pos = vector<size_t>(inputs.size(), 0);
+	multiway_co_rank(inputs.view(), k, pos.view());
+}
+
+/// pieces smaller than this are not worth a thread
+const size_t parallel_merge_grain = 1 << 14;
+
+/// stable merge of l and r into out on up to threads threads: out is cut into
+/// equal pieces, co_rank finds where each one starts in l and r
+/// and every thread merges its piece straight into out
+template<typename T>
+void parallel_merge(const_view_t<T> l, const_view_t<T> r, vector_view<T> out, size_t threads = hardware_threads()) {
+	assert(out.size() == l.size() + r.size());
+	const auto n = out.size();
+	const auto pieces = std::max<size_t>(std::min(threads, n / parallel_merge_grain), 1);
+	parallel_for(pieces, [&](size_t p) {
+		const auto from = p * n / pieces;
+		const auto to = (p + 1) * n / pieces;
+		const auto lf = co_rank(l, r, from);
+		const auto lt = co_rank(l, r, to);
+		merge<T>(l.view(lf, lt), r.view(from - lf, to - lt), out.view(from, to));
+	});
+}
+
+/// multiway_merge on up to threads threads, every thread finds the start and end
+/// of its piece of out in all inputs with multiway_co_rank
+template<typename T>
+void parallel_multiway_merge(const_view_t<vector_view<const T>> inputs, vector_view<T> out, size_t threads = hardware_threads()) {
+	const auto m = inputs.size();
+	if (m == 1) {
+		std::copy(inputs[0].begin(), inputs[0].end(), out.begin());
+		return;
+	}
+	if (m == 2) {
+		parallel_merge<T>(inputs[0], inputs[1], out, threads);
+		return;
+	}
+	const auto n = out.size();
+	const auto pieces = std::max<size_t>(std::min(threads, n / parallel_merge_grain), 1);
+	parallel_for(pieces, [&](size_t p) {
+		const auto from = p * n / pieces;
+		const auto to = (p + 1) * n / pieces;
+		vector<size_t> lo(m, 0);
+		vector<size_t> hi(m, 0);
+		multiway_co_rank(inputs, from, lo.view());
+		multiway_co_rank(inputs, to, hi.view());
+		vector<vector_view<const T>> parts;
+		parts.reserve(m);
+		for (size_t i = 0; i < m; ++i) {
+			parts.push_back(inputs[i].view(lo[i], hi[i]));
+		}
+		multiway_merge<T>(parts.view(), out.view(from, to));
+	});
+}
+
+template<typename T>
+void parallel_multiway_merge(const vector<vector_view<const T>>& inputs, vector<T>& out, size_t threads = hardware_threads()) {
+	size_t total = 0;
+	for (size_t i = 0; i < inputs.size(); ++i) {
+		total += inputs[i].size();
+	}
+	out = vector<T>(total, T{});
+	parallel_multiway_merge<T>(inputs.view(), out.view(), threads);
+}
+
+/// stable merge sort on up to threads threads: every thread merge sorts a slice,
+/// then the slices are merged by parallel_multiway_merge. needs a buffer as large as v.
+template<typename T>
+void parallel_merge_sort(vector_view<T> v, size_t threads = hardware_threads()) {
+	const auto n = v.size();
+	const auto pieces = std::max<size_t>(std::min(threads, n / parallel_merge_grain), 1);
+	ALGO_SORT_ALLOCATION(n * sizeof(T));
+	vector<T> buf(n, T{});
+	const auto slice = [&](size_t p) {
+		return pair<size_t, size_t>(p * n / pieces, (p + 1) * n / pieces);
+	};
+	parallel_for(pieces, [&](size_t p) {
+		const auto s = slice(p);
+		merge_sort(v.view(s.first, s.second), buf.view(s.first, s.second));
+	});
+	if (pieces == 1) {
+		return;
+	}
+
+	vector<vector_view<const T>> runs;
+	for (size_t p = 0; p < pieces; ++p) {
+		const auto s = slice(p);
+		runs.push_back(v.view(s.first, s.second));
+	}
+	parallel_multiway_merge<T>(runs.view(), buf.view(), pieces);
+	parallel_for(pieces, [&](size_t p) {
+		const auto s = slice(p);
+		std::copy(buf.data() + s.first, buf.data() + s.second, v.data() + s.first);
+	});
+}
+
+template<typename T>
+void parallel_merge_sort(vector<T>& v, size_t threads = hardware_threads()) {
+	parallel_merge_sort(v.view(), threads);
+}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <thread>
+
+#include "common.h"
+#include "vector.h"
+
+
+namespace algo {
+
+/// the number of threads the hardware runs at once, at least 1
+inline size_t hardware_threads() {
+	const auto res = std::thread::hardware_concurrency();
+	return res == 0 ? 1 : res;
+}
+
+/// runs f(0) .. f(n - 1) on n threads and waits for all of them,
+/// f(0) runs on the calling thread
+template<typename F>
+void parallel_for(size_t n, F&& f) {
+	vector<std::thread> threads;
+	threads.reserve(n);
+	for (size_t i = 1; i < n; ++i) {
+		threads.push_back(std::thread([&f, i]() {
+			f(i);
+		}));
+	}
+	if (n > 0) {
+		f(0);
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+}
+
+}
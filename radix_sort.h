@@ -0,0 +1,458 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+#include "common.h"
+#include "vector.h"
+#include "vector_view.h"
+#include "sort_stats.h"
+#include "pair.h"
+#include "fixed_string.h"
+#include "sort.h"
+#include "parallel.h"
+
+
+namespace algo {
+
+/// a radix sort pass looks at 8 bits of the keys
+const size_t radix_bits = 8;
+const size_t radix_buckets = static_cast<size_t>(1) << radix_bits;
+const size_t cache_line = 64;
+
+/// ranges up to this size are left to merge_sort
+const size_t radix_sort_base = 1 << 10;
+
+/// chunks smaller than this are not worth a thread
+const size_t parallel_radix_grain = 1 << 16;
+
+/// outputs larger than this do not fit in the caches,
+/// so the scatter writes them around the caches
+const size_t radix_stream_bytes = 8 << 20;
+
+/// one thread's part of a pass: its chunk of the input, where each bucket of it goes
+/// and a cache line of buffer for every bucket
+template<typename T>
+struct radix_local {
+	static const size_t line = cache_line / sizeof(T) > 0 ? cache_line / sizeof(T) : 1;
+	/// whether a cache line holds whole records, so lines of records can start on cache
+	/// lines if the records start on multiples of their size
+	static const bool whole_lines = cache_line % sizeof(T) == 0;
+
+	size_t begin{0};
+	size_t end{0};
+	size_t pos[radix_buckets];
+	vector<T> buf{};
+};
+
+template<typename T>
+const size_t radix_local<T>::line;
+
+template<typename T>
+const bool radix_local<T>::whole_lines;
+
+/// copies a full cache line of T to dst, which is cache line aligned, without
+/// reading it into the cache first
+template<typename T>
+void radix_stream_line(T * dst, const T * src) {
+#ifdef __x86_64__
+	static_assert(cache_line % sizeof(__m128i) == 0, "a line is a number of sse stores");
+	auto * d = reinterpret_cast<__m128i*>(dst);
+	const auto * s = reinterpret_cast<const __m128i*>(src);
+	for (size_t i = 0; i < cache_line / sizeof(__m128i); ++i) {
+		_mm_stream_si128(d + i, _mm_loadu_si128(s + i));
+	}
+#else
+	std::copy(src, src + cache_line / sizeof(T), dst);
+#endif
+}
+
+/// how the radix sorts see keys of type T: digits bytes, digit(x, 0) is the least
+/// significant one. the digits from the most significant one order the keys like
+/// less, which is < except for floats.
+template<typename T, typename Enable = void>
+struct radix_key;
+
+/// true if T has a radix_key, so the radix sorts take it
+template<typename T, typename Enable = void>
+struct has_radix_key : std::false_type {};
+
+template<typename T>
+struct has_radix_key<T, decltype(void(radix_key<T>::digits))> : std::true_type {};
+
+template<typename T>
+struct radix_key<T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type> {
+	static const size_t digits = sizeof(T);
+
+	static size_t digit(T x, size_t d) {
+		return static_cast<size_t>(x >> (radix_bits * d)) & (radix_buckets - 1);
+	}
+
+	static bool less(T a, T b) {
+		return a < b;
+	}
+};
+
+/// signed integers with the sign bit flipped order like unsigned ones
+template<typename T>
+struct radix_key<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type> {
+	using bits_type = typename std::make_unsigned<T>::type;
+
+	static const size_t digits = sizeof(T);
+
+	static bits_type bits(T x) {
+		return static_cast<bits_type>(x) ^ (static_cast<bits_type>(1) << (8 * sizeof(T) - 1));
+	}
+
+	static size_t digit(T x, size_t d) {
+		return radix_key<bits_type>::digit(bits(x), d);
+	}
+
+	static bool less(T a, T b) {
+		return a < b;
+	}
+};
+
+/// the bits of a positive float order like the float, those of a negative one in
+/// reverse: negative floats get all bits flipped, positive ones the sign bit.
+/// -0 comes before 0 and NaNs go to the ends, by their sign.
+template<typename T>
+struct radix_key<T, typename std::enable_if<std::is_floating_point<T>::value && (sizeof(T) == 4 || sizeof(T) == 8)>::type> {
+	using bits_type = typename std::conditional<sizeof(T) == 4, uint32_t, uint64_t>::type;
+
+	static const size_t digits = sizeof(T);
+
+	static bits_type bits(T x) {
+		bits_type u;
+		memcpy(&u, &x, sizeof(u));
+		const auto sign = static_cast<bits_type>(1) << (8 * sizeof(T) - 1);
+		return u ^ ((static_cast<bits_type>(0) - (u >> (8 * sizeof(T) - 1))) | sign);
+	}
+
+	static size_t digit(T x, size_t d) {
+		return radix_key<bits_type>::digit(bits(x), d);
+	}
+
+	static bool less(T a, T b) {
+		return bits(a) < bits(b);
+	}
+};
+
+/// pairs compare by their first element
+template<typename K, typename V>
+struct radix_key<pair<K, V>, typename std::enable_if<has_radix_key<K>::value>::type> {
+	static const size_t digits = radix_key<K>::digits;
+
+	static size_t digit(const pair<K, V>& x, size_t d) {
+		return radix_key<K>::digit(x.first, d);
+	}
+
+	static bool less(const pair<K, V>& a, const pair<K, V>& b) {
+		return radix_key<K>::less(a.first, b.first);
+	}
+};
+
+/// one digit per char, the last char is the least significant
+template<size_t N>
+struct radix_key<fixed_string<N>> {
+	static const size_t digits = N;
+
+	static size_t digit(const fixed_string<N>& x, size_t d) {
+		return static_cast<unsigned char>(x.chars[N - 1 - d]);
+	}
+
+	static bool less(const fixed_string<N>& a, const fixed_string<N>& b) {
+		return a < b;
+	}
+};
+
+/// compares keys like a radix sort orders them
+struct radix_less {
+	template<typename K>
+	bool operator()(const K& a, const K& b) const {
+		return radix_key<K>::less(a, b);
+	}
+};
+
+/// moves l's chunk of src to dst by digit d of their keys. elements of a bucket
+/// collect in its buffer until the next one would start a new cache line of dst, so dst is
+/// written a whole line at a time, except at the ends of the buckets.
+template<typename T, typename Key>
+void radix_scatter(radix_local<T>& l, const T * src, T * dst, size_t d, bool stream, const Key& key) {
+	using K = typename std::decay<decltype(key(*src))>::type;
+	const auto line = radix_local<T>::line;
+	auto * buf = l.buf.data();
+	// views may wrap memory aligned to less than sizeof(T), then full lines do not
+	// start on cache lines and are copied as they are
+	const auto aligned = radix_local<T>::whole_lines && reinterpret_cast<uintptr_t>(dst) % sizeof(T) == 0;
+	size_t fill[radix_buckets];
+	size_t left[radix_buckets];
+	for (size_t b = 0; b < radix_buckets; ++b) {
+		fill[b] = 0;
+		// the number of elements until dst + pos is cache line aligned
+		const auto offset = reinterpret_cast<uintptr_t>(dst + l.pos[b]) % cache_line;
+		left[b] = !aligned || offset == 0 ? line : (cache_line - offset) / sizeof(T);
+	}
+	for (auto i = l.begin; i < l.end; ++i) {
+		const auto& val = src[i];
+		const auto b = radix_key<K>::digit(key(val), d);
+		auto * lb = buf + b * line;
+		lb[fill[b]] = val;
+		++fill[b];
+		--left[b];
+		if (left[b] == 0) {
+			auto * out = dst + l.pos[b];
+			if (fill[b] < line) {
+				std::copy(lb, lb + fill[b], out);
+			}
+			else if (stream && aligned) {
+				radix_stream_line(out, lb);
+			}
+			else {
+				// a constant length copy is a few vector moves, std::copy of fill[b] a call
+				for (size_t k = 0; k < line; ++k) {
+					out[k] = lb[k];
+				}
+			}
+			l.pos[b] += fill[b];
+			fill[b] = 0;
+			left[b] = line;
+		}
+	}
+	for (size_t b = 0; b < radix_buckets; ++b) {
+		std::copy(buf + b * line, buf + b * line + fill[b], dst + l.pos[b]);
+	}
+#ifdef __x86_64__
+	if (stream) {
+		_mm_sfence();
+	}
+#endif
+}
+
+/// parallel_radix_sort of records T by key(record), which has a radix_key. stable.
+template<typename T, typename Key>
+void parallel_radix_sort_records(vector_view<T> v, size_t threads, const Key& key) {
+	using K = typename std::decay<decltype(key(v[0]))>::type;
+	const auto n = v.size();
+	if (n <= radix_sort_base) {
+		ALGO_SORT_ALLOCATION(n * sizeof(T));
+		vector<T> buf(n, T{});
+		merge_sort(v, buf.view(), radix_less(), key);
+		return;
+	}
+	threads = std::max<size_t>(std::min(threads, n / parallel_radix_grain), 1);
+	// not initialized, so every page is first touched by the thread that writes it
+	ALGO_SORT_ALLOCATION(n * sizeof(T));
+	std::unique_ptr<T[]> tmp(new T[n]);
+	vector<radix_local<T>> locals(threads, radix_local<T>());
+	vector<size_t> counts(threads * radix_buckets, 0);
+	for (size_t t = 0; t < threads; ++t) {
+		locals[t].begin = t * n / threads;
+		locals[t].end = (t + 1) * n / threads;
+	}
+	const auto stream = n * sizeof(T) > radix_stream_bytes;
+
+	auto * src = v.data();
+	auto * dst = tmp.get();
+	for (size_t d = 0; d < radix_key<K>::digits; ++d) {
+		parallel_for(threads, [&](size_t t) {
+			auto * c = counts.data() + t * radix_buckets;
+			std::fill(c, c + radix_buckets, 0);
+			for (auto i = locals[t].begin; i < locals[t].end; ++i) {
+				++c[radix_key<K>::digit(key(src[i]), d)];
+			}
+		});
+
+		// bucket by bucket, thread by thread, so equal digits keep their order
+		size_t sum = 0;
+		bool trivial = false;
+		for (size_t b = 0; b < radix_buckets; ++b) {
+			const auto start = sum;
+			for (size_t t = 0; t < threads; ++t) {
+				locals[t].pos[b] = sum;
+				sum += counts[t * radix_buckets + b];
+			}
+			trivial = trivial || sum - start == n;
+		}
+		if (trivial) {
+			continue;
+		}
+
+		parallel_for(threads, [&](size_t t) {
+			auto& l = locals[t];
+			if (l.buf.size() < radix_buckets * l.line) {
+				l.buf = vector<T>(radix_buckets * l.line, T{});
+			}
+			radix_scatter(l, src, dst, d, stream, key);
+		});
+		std::swap(src, dst);
+	}
+
+	if (src != v.data()) {
+		parallel_for(threads, [&](size_t t) {
+			std::copy(src + locals[t].begin, src + locals[t].end, v.data() + locals[t].begin);
+		});
+	}
+}
+
+/// LSD radix sort on up to threads threads, a byte of the keys per pass. T and the
+/// key of proj are integers, floats, pairs of those or fixed_strings, see radix_key.
+/// every pass each thread counts the digits of its chunk, the counts of all threads
+/// give every thread and bucket its place in the output and then each thread moves
+/// its chunk there, stable, through write combining buffers of a cache line per bucket.
+/// passes in which all keys have the same digit are skipped.
+/// needs a buffer as large as v.
+template<typename T, typename Proj, typename std::enable_if<!std::is_integral<Proj>::value, int>::type = 0>
+void parallel_radix_sort(vector_view<T> v, Proj proj, size_t threads = hardware_threads()) {
+	parallel_radix_sort_records(v, threads, proj);
+}
+
+template<typename T, typename Proj, typename std::enable_if<!std::is_integral<Proj>::value, int>::type = 0>
+void parallel_radix_sort(vector<T>& v, Proj proj, size_t threads = hardware_threads()) {
+	parallel_radix_sort_records(v.view(), threads, proj);
+}
+
+template<typename T>
+void parallel_radix_sort(vector_view<T> v, size_t threads = hardware_threads()) {
+	parallel_radix_sort_records(v, threads, identity());
+}
+
+template<typename T>
+void parallel_radix_sort(vector<T>& v, size_t threads = hardware_threads()) {
+	parallel_radix_sort(v.view(), threads);
+}
+
+/// parallel_radix_sort on the calling thread only. stable, needs a buffer as large as v.
+template<typename T, typename Proj = identity>
+void lsd_radix_sort(vector_view<T> v, Proj proj = Proj()) {
+	parallel_radix_sort_records(v, 1, proj);
+}
+
+template<typename T, typename Proj = identity>
+void lsd_radix_sort(vector<T>& v, Proj proj = Proj()) {
+	lsd_radix_sort(v.view(), proj);
+}
+
+/// ranges up to this size are insertion sorted by the msd radix sorts
+const size_t msd_radix_sort_base = 32;
+
+/// msd_radix_sort of v by digit d of the keys and the less significant ones
+template<typename T, typename Key>
+void msd_radix_sort_digit(vector_view<T> v, size_t d, const Key& key) {
+	using K = typename std::decay<decltype(key(v[0]))>::type;
+	ALGO_SORT_DEPTH();
+	if (v.size() <= msd_radix_sort_base) {
+		insertion_sort(v, radix_less(), key);
+		return;
+	}
+	size_t counts[radix_buckets] = {};
+	for (size_t i = 0; i < v.size(); ++i) {
+		++counts[radix_key<K>::digit(key(v[i]), d)];
+	}
+	// the next free slot and the end of every bucket
+	size_t next[radix_buckets];
+	size_t end[radix_buckets];
+	size_t sum = 0;
+	for (size_t b = 0; b < radix_buckets; ++b) {
+		next[b] = sum;
+		sum += counts[b];
+		end[b] = sum;
+	}
+	for (size_t b = 0; b < radix_buckets; ++b) {
+		while (next[b] < end[b]) {
+			const auto db = radix_key<K>::digit(key(v[next[b]]), d);
+			if (db == b) {
+				++next[b];
+			}
+			else {
+				std::swap(v[next[b]], v[next[db]]);
+				++next[db];
+			}
+		}
+	}
+	if (d == 0) {
+		return;
+	}
+	size_t from = 0;
+	for (size_t b = 0; b < radix_buckets; ++b) {
+		if (counts[b] > 1) {
+			msd_radix_sort_digit(v.view(from, from + counts[b]), d - 1, key);
+		}
+		from += counts[b];
+	}
+}
+
+/// MSD radix sort in place (American flag sort) by the radix_key of proj(x): the
+/// elements are swapped into the buckets of the most significant digit, then each
+/// bucket is sorted by the next digit. small buckets are insertion sorted. not stable.
+template<typename T, typename Proj = identity>
+void msd_radix_sort(vector_view<T> v, Proj proj = Proj()) {
+	using K = typename std::decay<decltype(proj(v[0]))>::type;
+	if (v.size() > 1) {
+		msd_radix_sort_digit(v, radix_key<K>::digits - 1, proj);
+	}
+}
+
+template<typename T, typename Proj = identity>
+void msd_radix_sort(vector<T>& v, Proj proj = Proj()) {
+	msd_radix_sort(v.view(), proj);
+}
+
+/// msd_radix_sort_bin of v by bit b of the keys and the less significant ones
+template<typename T, typename Key>
+void msd_radix_sort_bin(vector_view<T> v, size_t b, const Key& key) {
+	using K = typename std::decay<decltype(key(v[0]))>::type;
+	ALGO_SORT_DEPTH();
+	if (v.size() <= msd_radix_sort_base) {
+		insertion_sort(v, radix_less(), key);
+		return;
+	}
+	const auto one = [&](const T& x) {
+		return (radix_key<K>::digit(key(x), b / radix_bits) >> (b % radix_bits) & 1) != 0;
+	};
+	size_t i = 0;
+	size_t j = v.size();
+	while (true) {
+		while (i < j && !one(v[i])) {
+			++i;
+		}
+		while (i < j && one(v[j - 1])) {
+			--j;
+		}
+		if (i == j) {
+			break;
+		}
+		std::swap(v[i], v[j - 1]);
+		++i;
+		--j;
+	}
+	if (b == 0) {
+		return;
+	}
+	msd_radix_sort_bin(v.view(0, i), b - 1, key);
+	msd_radix_sort_bin(v.view(i), b - 1, key);
+}
+
+/// binary MSD radix sort in place (radix exchange sort) by the radix_key of proj(x):
+/// v is partitioned by the most significant bit like quick sort, then both parts by
+/// the next bit. not stable.
+template<typename T, typename Proj = identity>
+void msd_radix_sort_bin(vector_view<T> v, Proj proj = Proj()) {
+	using K = typename std::decay<decltype(proj(v[0]))>::type;
+	if (v.size() > 1) {
+		msd_radix_sort_bin(v, radix_key<K>::digits * radix_bits - 1, proj);
+	}
+}
+
+template<typename T, typename Proj = identity>
+void msd_radix_sort_bin(vector<T>& v, Proj proj = Proj()) {
+	msd_radix_sort_bin(v.view(), proj);
+}
+
+}
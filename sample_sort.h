@@ -0,0 +1,488 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "common.h"
+#include "vector.h"
+#include "vector_view.h"
+#include "sort_stats.h"
+#include "sort.h"
+#include "parallel.h"
+
+
+namespace algo {
+
+/// up to 2^log_buckets - 1 sorted splitters in Eytzinger order: classifying
+/// an element is log_buckets steps i = 2i + (tree[i] < x) with no branches,
+/// the leaf reached is the number of splitters less than x.
+/// with equality buckets every splitter also gets a bucket of its own,
+/// that is how many equal elements are kept from being sorted over and over.
+template<typename T>
+class splitter_tree {
+public:
+	static const size_t max_log_buckets = 8;
+
+	splitter_tree() = default;
+
+	/// splitters are sorted, there are at most 2^log_buckets - 1 of them
+	splitter_tree(vector_view<const T> splitters, size_t log_buckets, bool equality) :
+		log_k(log_buckets), k(static_cast<size_t>(1) << log_buckets), equal(equality) {
+		assert(log_buckets <= max_log_buckets);
+		assert(!splitters.empty() && splitters.size() < k);
+		// pad with the largest splitter, the tree has to be complete
+		for (size_t i = 0; i < k; ++i) {
+			sorted[i] = splitters[i < splitters.size() ? i : splitters.size() - 1];
+		}
+		size_t pos = 0;
+		build(pos, 1);
+	}
+
+	size_t buckets() const {
+		return equal ? 2 * k : k;
+	}
+
+	bool equality() const {
+		return equal;
+	}
+
+	size_t operator()(const T& x) const {
+		size_t i = 1;
+		for (size_t l = 0; l < log_k; ++l) {
+			i = 2 * i + (tree[i] < x);
+		}
+		return finish(i, x);
+	}
+
+	/// U elements at once, so their descents overlap instead of waiting on each other
+	template<size_t U>
+	void classify(const T * x, size_t * out) const {
+		size_t i[U];
+		for (size_t u = 0; u < U; ++u) {
+			i[u] = 1;
+		}
+		for (size_t l = 0; l < log_k; ++l) {
+			for (size_t u = 0; u < U; ++u) {
+				i[u] = 2 * i[u] + (tree[i[u]] < x[u]);
+			}
+		}
+		for (size_t u = 0; u < U; ++u) {
+			out[u] = finish(i[u], x[u]);
+		}
+	}
+
+private:
+	size_t finish(size_t i, const T& x) const {
+		i -= k;
+		if (equal) {
+			// odd buckets hold the elements equal to splitter i
+			i = 2 * i + ((i < k - 1) & !(x < sorted[i]));
+		}
+		return i;
+	}
+
+	void build(size_t& pos, size_t n) {
+		if (n >= k) {
+			return;
+		}
+		build(pos, 2 * n);
+		tree[n] = sorted[pos];
+		++pos;
+		build(pos, 2 * n + 1);
+	}
+
+	size_t log_k{0};
+	size_t k{0};
+	bool equal{false};
+	T tree[1 << max_log_buckets];
+	T sorted[1 << max_log_buckets];
+};
+
+template<typename T>
+const size_t splitter_tree<T>::max_log_buckets;
+
+/// the state of one in-place distribution of a range into the buckets of a splitter_tree
+template<typename T>
+class sample_partition {
+public:
+	/// elements are moved in blocks of about 2KiB
+	static const size_t block = 2048 / sizeof(T) > 0 ? 2048 / sizeof(T) : 1;
+
+	/// per thread buffers: one block per bucket
+	struct local {
+		vector<T> buf{};
+		vector<size_t> fill{};
+		vector<size_t> counts{};
+		vector<T> swap{};
+		size_t begin{0};
+		size_t end{0};
+		size_t written{0};
+	};
+
+	sample_partition(vector_view<T> v, const splitter_tree<T>& t, vector_view<local> l) :
+		starts(t.buckets() + 1, 0), arr(v.data()), n(v.size()), tree(t), nb(t.buckets()), locals(l),
+		delims(nb + 1, 0), reads(nb, 0), writes(nb, 0), locks(new std::mutex[nb]) {}
+
+	/// moves the elements of v into their buckets, locals.size() threads work on it.
+	/// bucket b ends up in [starts[b], starts[b + 1]).
+	void run() {
+		const auto threads = locals.size();
+		// stripes start on block boundaries, so blocks written back line up everywhere
+		const auto blocks = n / block;
+		for (size_t t = 0; t < threads; ++t) {
+			auto& l = locals[t];
+			l.begin = t * blocks / threads * block;
+			l.end = t + 1 == threads ? n : (t + 1) * blocks / threads * block;
+		}
+		parallel_for(threads, [this](size_t t) {
+			classify(locals[t]);
+		});
+
+		for (size_t b = 0; b < nb; ++b) {
+			size_t cnt = 0;
+			for (size_t t = 0; t < threads; ++t) {
+				cnt += locals[t].counts[b];
+			}
+			starts[b + 1] = starts[b] + cnt;
+			delims[b + 1] = (starts[b + 1] + block - 1) / block * block;
+		}
+		const auto full = compact();
+		for (size_t b = 0; b < nb; ++b) {
+			writes[b] = delims[b];
+			reads[b] = std::max(delims[b], std::min(delims[b + 1], full));
+		}
+		ALGO_SORT_ALLOCATION(block * sizeof(T));
+		overflow = vector<T>(block, T{});
+		overflow_bucket = nb;
+		parallel_for(threads, [this, threads](size_t t) {
+			permute(locals[t], t * nb / threads);
+		});
+		cleanup();
+	}
+
+	vector<size_t> starts;
+
+private:
+	/// local classification: full blocks go back to the front of the stripe
+	void classify(local& l) {
+		if (l.buf.size() < nb * block) {
+			ALGO_SORT_ALLOCATION(nb * block * sizeof(T));
+			l.buf = vector<T>(nb * block, T{});
+		}
+		l.fill = vector<size_t>(nb, 0);
+		l.counts = vector<size_t>(nb, 0);
+		l.written = l.begin;
+		const size_t U = 8;
+		size_t idx[U];
+		auto i = l.begin;
+		for (; i + U <= l.end; i += U) {
+			tree.template classify<U>(arr + i, idx);
+			for (size_t u = 0; u < U; ++u) {
+				push(l, idx[u], arr[i + u]);
+			}
+		}
+		for (; i < l.end; ++i) {
+			push(l, tree(arr[i]), arr[i]);
+		}
+	}
+
+	void push(local& l, size_t b, const T& val) {
+		auto * dst = l.buf.data() + b * block;
+		dst[l.fill[b]] = val;
+		++l.fill[b];
+		++l.counts[b];
+		if (l.fill[b] == block) {
+			// at least a block more was read than written, so this never overwrites unread elements
+			std::copy(dst, dst + block, arr + l.written);
+			l.written += block;
+			l.fill[b] = 0;
+		}
+	}
+
+	/// moves the full blocks at the end of stripes into the gaps at the end of the
+	/// earlier stripes, so all full blocks are in [0, full). the gaps are smaller
+	/// than a block per bucket and thread, so this moves little.
+	size_t compact() {
+		size_t full = 0;
+		for (size_t t = 0; t < locals.size(); ++t) {
+			full += locals[t].written - locals[t].begin;
+		}
+		size_t src_t = locals.size();
+		size_t src = 0;
+		for (size_t t = 0; t < locals.size(); ++t) {
+			for (auto gap = locals[t].written; gap < locals[t].end && gap < full; gap += block) {
+				// the next full block at or after full, from the back
+				while (src_t == locals.size() || src <= std::max(locals[src_t].begin, full)) {
+					--src_t;
+					src = locals[src_t].written;
+				}
+				src -= block;
+				std::copy(arr + src, arr + src + block, arr + gap);
+			}
+		}
+		return full;
+	}
+
+	/// block permutation: every thread takes unprocessed blocks out of the buckets
+	/// and swaps them into the next free slot of the bucket they belong to.
+	/// bucket b has full blocks waiting in [writes[b], reads[b]), the slots below writes[b] are done.
+	void permute(local& l, size_t first) {
+		if (l.swap.size() < block) {
+			ALGO_SORT_ALLOCATION(block * sizeof(T));
+			l.swap = vector<T>(block, T{});
+		}
+		auto * blk = l.swap.data();
+		for (size_t k = 0; k < nb; ++k) {
+			const auto b = (first + k) % nb;
+			while (true) {
+				locks[b].lock();
+				if (reads[b] <= writes[b]) {
+					locks[b].unlock();
+					break;
+				}
+				reads[b] -= block;
+				std::copy(arr + reads[b], arr + reads[b] + block, blk);
+				locks[b].unlock();
+
+				bool placed = false;
+				while (!placed) {
+					const auto dst = tree(blk[0]);
+					locks[dst].lock();
+					const auto slot = writes[dst];
+					writes[dst] += block;
+					if (slot < reads[dst]) {
+						std::swap_ranges(blk, blk + block, arr + slot);
+					}
+					else {
+						// only the last block of the last bucket can stick out of the range
+						if (slot + block <= n) {
+							std::copy(blk, blk + block, arr + slot);
+						}
+						else {
+							std::copy(blk, blk + block, overflow.data());
+							overflow_bucket = dst;
+						}
+						placed = true;
+					}
+					locks[dst].unlock();
+				}
+			}
+		}
+	}
+
+	/// the full blocks of bucket b start at delims[b] >= starts[b], so the first
+	/// elements of the bucket and the last ones of the previous bucket are in the wrong
+	/// place. fills every bucket's holes with its overhanging elements and the
+	/// leftovers of the thread buffers, in bucket order, so holes are free when filled.
+	void cleanup() {
+		const auto threads = locals.size();
+		vector<vector_view<const T>> sources;
+		for (size_t b = 0; b < nb; ++b) {
+			const auto s = starts[b];
+			const auto e = starts[b + 1];
+			const auto d = std::min(delims[b], e);
+			auto full_end = writes[b];
+			sources.clear();
+			if (b == overflow_bucket) {
+				full_end -= block;
+				sources.push_back(overflow.view());
+			}
+			const auto overhang = std::max(e, delims[b]);
+			if (full_end > overhang) {
+				sources.push_back(vector_view<const T>(arr + overhang, full_end - overhang));
+			}
+			for (size_t t = 0; t < threads; ++t) {
+				sources.push_back(vector_view<const T>(locals[t].buf.data() + b * block, locals[t].fill[b]));
+			}
+
+			auto * dst = arr + s;
+			auto * hole_end = arr + d;
+			for (const auto& src : sources) {
+				for (const auto& val : src) {
+					if (dst == hole_end) {
+						dst = arr + std::min(std::max(full_end, delims[b]), e);
+						hole_end = arr + e;
+					}
+					*dst = val;
+					++dst;
+				}
+			}
+			assert(dst == arr + e || (dst == arr + d && std::min(std::max(full_end, delims[b]), e) == e));
+		}
+	}
+
+	T * arr;
+	size_t n;
+	const splitter_tree<T>& tree;
+	size_t nb;
+	vector_view<local> locals;
+	vector<size_t> delims;
+	vector<size_t> reads;
+	vector<size_t> writes;
+	std::unique_ptr<std::mutex[]> locks;
+	vector<T> overflow{};
+	size_t overflow_bucket{0};
+};
+
+template<typename T>
+const size_t sample_partition<T>::block;
+
+/// ranges up to this size are left to intro_sort
+const size_t sample_sort_base = 1 << 12;
+
+/// picks the splitters for v from a random sample, oversampled by about log2(n) / 5
+template<typename T>
+splitter_tree<T> sample_splitters(vector_view<const T> v, uint64_t& seed) {
+	const auto n = v.size();
+	const auto blk = sample_partition<T>::block;
+	size_t log_k = 1;
+	while (log_k < splitter_tree<T>::max_log_buckets && (static_cast<size_t>(2) << log_k) * blk * 4 <= n) {
+		++log_k;
+	}
+	const auto k = static_cast<size_t>(1) << log_k;
+	size_t log_n = 0;
+	while ((static_cast<size_t>(1) << log_n) < n) {
+		++log_n;
+	}
+	const auto step = std::max<size_t>(log_n / 5, 1);
+
+	vector<T> sample;
+	sample.reserve(step * k);
+	for (size_t i = 0; i < step * k; ++i) {
+		// splitmix64
+		seed += 0x9e3779b97f4a7c15ULL;
+		auto z = seed;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		sample.push_back(v[(z ^ (z >> 31)) % n]);
+	}
+	intro_sort(sample.view());
+
+	vector<T> splitters;
+	for (size_t i = 1; i < k; ++i) {
+		const auto& s = sample[i * step - 1];
+		if (splitters.empty() || splitters.back() < s) {
+			splitters.push_back(s);
+		}
+	}
+	// repeated splitters mean many equal elements, they get buckets of their own
+	const auto equality = splitters.size() < k - 1;
+	if (equality) {
+		log_k = 1;
+		while ((static_cast<size_t>(1) << log_k) <= splitters.size()) {
+			++log_k;
+		}
+	}
+	return splitter_tree<T>(splitters.view(), log_k, equality);
+}
+
+/// false if all elements went to a single bucket that is not an equality bucket,
+/// which few distinct values and an unlucky sample can cause
+inline bool progress(const vector<size_t>& starts, bool equality) {
+	const auto n = starts.back();
+	for (size_t b = 0; b + 1 < starts.size(); ++b) {
+		if (starts[b + 1] - starts[b] == n) {
+			return equality && b % 2 == 1;
+		}
+	}
+	return true;
+}
+
+template<typename T>
+void sample_sort(vector_view<T> v, vector<typename sample_partition<T>::local>& scratch, uint64_t& seed);
+
+/// sorts the buckets of a distribution, equality buckets are already sorted
+template<typename T>
+void sample_sort_buckets(vector_view<T> v, const vector<size_t>& starts, bool equality, vector<typename sample_partition<T>::local>& scratch, uint64_t& seed) {
+	for (size_t b = 0; b + 1 < starts.size(); ++b) {
+		if (!equality || b % 2 == 0) {
+			sample_sort(v.view(starts[b], starts[b + 1]), scratch, seed);
+		}
+	}
+}
+
+template<typename T>
+void sample_sort(vector_view<T> v, vector<typename sample_partition<T>::local>& scratch, uint64_t& seed) {
+	ALGO_SORT_DEPTH();
+	if (v.size() <= sample_sort_base) {
+		intro_sort(v);
+		return;
+	}
+	const auto tree = std::make_unique<splitter_tree<T>>(sample_splitters(vector_view<const T>(v), seed));
+	sample_partition<T> part(v, *tree, scratch.view());
+	part.run();
+	if (!progress(part.starts, tree->equality())) {
+		intro_sort(v);
+		return;
+	}
+	sample_sort_buckets(v, part.starts, tree->equality(), scratch, seed);
+}
+
+/// in-place super scalar sample sort (IPS4o): elements are classified by a
+/// branchless splitter_tree into up to 256 buckets, moved into them in blocks
+/// through a buffer block per bucket, and the buckets are sorted recursively.
+/// besides the recursion it needs a block per bucket, O(block * buckets) memory.
+template<typename T>
+void sample_sort(vector_view<T> v) {
+	vector<typename sample_partition<T>::local> scratch(1, typename sample_partition<T>::local());
+	uint64_t seed = v.size();
+	sample_sort(v, scratch, seed);
+}
+
+template<typename T>
+void sample_sort(vector<T>& v) {
+	sample_sort(v.view());
+}
+
+/// sample_sort on up to threads threads: they classify a stripe each, permute the
+/// blocks together and then sort the buckets, the largest ones with all threads
+/// and the others one per thread. needs O(threads * block * buckets) memory.
+template<typename T>
+void parallel_sample_sort(vector_view<T> v, size_t threads = hardware_threads()) {
+	using local = typename sample_partition<T>::local;
+	const auto n = v.size();
+	threads = std::max<size_t>(std::min(threads, n / (sample_sort_base * 4)), 1);
+	if (threads == 1) {
+		sample_sort(v);
+		return;
+	}
+
+	uint64_t seed = n;
+	const auto tree = std::make_unique<splitter_tree<T>>(sample_splitters(vector_view<const T>(v), seed));
+	vector<local> locals(threads, local());
+	sample_partition<T> part(v, *tree, locals.view());
+	part.run();
+	const auto& starts = part.starts;
+	const auto equality = tree->equality();
+	locals = vector<local>();
+	if (!progress(starts, equality)) {
+		intro_sort(v);
+		return;
+	}
+
+	const auto buckets = starts.size() - 1;
+	const auto big = n / threads;
+	for (size_t b = 0; b < buckets; ++b) {
+		if ((!equality || b % 2 == 0) && starts[b + 1] - starts[b] > big) {
+			parallel_sample_sort(v.view(starts[b], starts[b + 1]), threads);
+		}
+	}
+	std::atomic<size_t> next{0};
+	parallel_for(threads, [&](size_t t) {
+		vector<local> scratch(1, local());
+		uint64_t s = seed + t;
+		for (auto b = next++; b < buckets; b = next++) {
+			if ((!equality || b % 2 == 0) && starts[b + 1] - starts[b] <= big) {
+				sample_sort(v.view(starts[b], starts[b + 1]), scratch, s);
+			}
+		}
+	});
+}
+
+template<typename T>
+void parallel_sample_sort(vector<T>& v, size_t threads = hardware_threads()) {
+	parallel_sample_sort(v.view(), threads);
+}
+
+}
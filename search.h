@@ -3,34 +3,194 @@
 #include "common.h"
 #include "vector.h"
 #include "heap.h"
+#include "pair.h"
+#include "simd.h"
 
 
 namespace algo {
 
+/// the first element equal to val or nullptr.
+/// integer and floating point elements are compared 32 bytes at a time with AVX2
+/// when the cpu has it, anything else goes through a loop compilers vectorize.
+template<typename T>
+T * linear_search(vector_view<T> vec, const view_value_t<T>& val) {
+	const auto i = find_first(vec.data(), vec.size(), val, simd_enabled<view_value_t<T>>());
+	return i == vec.size() ? nullptr : vec.data() + i;
+}
+
 template<typename T>
 T * linear_search(vector<T>& vec, const T& val) {
-	for (size_t i = 0; i < vec.size(); ++i) {
-		if (vec[i] == val) {
-			return &vec[i];
-		}
+	return linear_search(vec.view(), val);
+}
+
+template<typename T>
+const T * linear_search(const vector<T>& vec, const T& val) {
+	return linear_search(vec.view(), val);
+}
+
+/// the number of elements equal to val
+template<typename T>
+size_t count_equal(vector_view<T> vec, const view_value_t<T>& val) {
+	return count_equal(vec.data(), vec.size(), val, simd_enabled<view_value_t<T>>());
+}
+
+template<typename T>
+size_t count_equal(const vector<T>& vec, const T& val) {
+	return count_equal(vec.view(), val);
+}
+
+/// indexes of all elements equal to val in increasing order
+template<typename T>
+vector<size_t> find_all(vector_view<T> vec, const view_value_t<T>& val) {
+	vector<size_t> res;
+	find_all(vec.data(), vec.size(), val, res, simd_enabled<view_value_t<T>>());
+	return res;
+}
+
+template<typename T>
+vector<size_t> find_all(const vector<T>& vec, const T& val) {
+	return find_all(vec.view(), val);
+}
+
+/// the first element not less than val or the end of vec.
+/// the loop has no data dependent branches: the halving step compiles to
+/// a conditional move, and both possible next midpoints are prefetched
+/// so the memory latency of large arrays overlaps with the comparisons.
+template<typename T>
+T * lower_bound(vector_view<T> vec, const view_value_t<T>& val) {
+	auto * base = vec.data();
+	auto n = vec.size();
+	if (n == 0) {
+		return base;
+	}
+	while (n > 1) {
+		const auto half = n / 2;
+		n -= half;
+		__builtin_prefetch(base + n / 2);
+		__builtin_prefetch(base + half + n / 2);
+		base = base[half] < val ? base + half : base;
+	}
+	return base + (*base < val);
+}
+
+/// the first element greater than val or the end of vec
+template<typename T>
+T * upper_bound(vector_view<T> vec, const view_value_t<T>& val) {
+	auto * base = vec.data();
+	auto n = vec.size();
+	if (n == 0) {
+		return base;
+	}
+	while (n > 1) {
+		const auto half = n / 2;
+		n -= half;
+		__builtin_prefetch(base + n / 2);
+		__builtin_prefetch(base + half + n / 2);
+		base = val < base[half] ? base : base + half;
 	}
-	return nullptr;
+	return base + !(val < *base);
 }
 
+/// the range [first, second) of elements equal to val
 template<typename T>
-T * binary_search(vector_view<T> vec, const T& val) {
-	if (vec.empty()) {
+pair<T*, T*> equal_range(vector_view<T> vec, const view_value_t<T>& val) {
+	return pair<T*, T*>(lower_bound(vec, val), upper_bound(vec, val));
+}
+
+/// the first element equal to val or nullptr
+template<typename T>
+T * binary_search(vector_view<T> vec, const view_value_t<T>& val) {
+	auto * res = lower_bound(vec, val);
+	if (res == vec.data() + vec.size() || !(*res == val)) {
 		return nullptr;
 	}
+	return res;
+}
 
-	const auto middle = vec.size() / 2;
-	if (val == vec[middle]) {
-		return &vec[middle];
+/// index of the first element equal to val in the sorted vec, galloping from
+/// position from, so a walk over increasing values touches vec like a merge
+template<typename T>
+size_t gallop_search(vector_view<T> vec, size_t& from, const view_value_t<T>& val) {
+	const auto * arr = vec.data();
+	const auto n = vec.size();
+	size_t lo = from;
+	size_t step = 1;
+	while (lo + step < n && arr[lo + step] < val) {
+		lo += step;
+		step *= 2;
 	}
-	else if (val > vec[middle]) {
-		return binary_search(vec.view(middle + 1), val);
+	auto hi = lo + step < n ? lo + step + 1 : n;
+	while (lo < hi) {
+		const auto mid = lo + (hi - lo) / 2;
+		if (arr[mid] < val) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
 	}
-	return binary_search(vec.view(0, middle), val);
+	from = lo;
+	return lo < n && arr[lo] == val ? lo : n;
+}
+
+/// binary_search for every needle: out[i] is the index of the first element
+/// equal to needles[i] in the sorted haystack or haystack.size() if there is none.
+/// searches run in groups of G in lockstep and prefetch their next probes,
+/// so G cache misses are in flight at once instead of one.
+/// sorted needles are found with a single galloping merge over the haystack.
+template<typename T, typename U, size_t G = 16>
+void batch_search(vector_view<T> haystack, vector_view<U> needles, vector<size_t>& out) {
+	out.clear();
+	out.reserve(needles.size());
+	const auto * arr = haystack.data();
+	const auto * keys = needles.data();
+	const auto n = haystack.size();
+	const auto m = needles.size();
+	if (n == 0) {
+		for (size_t i = 0; i < m; ++i) {
+			out.push_back(0);
+		}
+		return;
+	}
+
+	bool sorted = true;
+	for (size_t i = 1; i < m && sorted; ++i) {
+		sorted = !(keys[i] < keys[i - 1]);
+	}
+	if (sorted) {
+		size_t from = 0;
+		for (size_t i = 0; i < m; ++i) {
+			out.push_back(gallop_search(haystack, from, keys[i]));
+		}
+		return;
+	}
+
+	size_t base[G];
+	for (size_t first = 0; first < m; first += G) {
+		const auto cnt = first + G <= m ? G : m - first;
+		const auto * group = keys + first;
+		for (size_t g = 0; g < cnt; ++g) {
+			base[g] = 0;
+		}
+		auto len = n;
+		while (len > 1) {
+			const auto half = len / 2;
+			len -= half;
+			for (size_t g = 0; g < cnt; ++g) {
+				base[g] = arr[base[g] + half] < group[g] ? base[g] + half : base[g];
+				__builtin_prefetch(arr + base[g] + len / 2);
+			}
+		}
+		for (size_t g = 0; g < cnt; ++g) {
+			const auto pos = base[g] + (arr[base[g]] < group[g]);
+			out.push_back(pos < n && arr[pos] == group[g] ? pos : n);
+		}
+	}
+}
+
+template<typename T>
+void batch_search(const vector<T>& haystack, const vector<T>& needles, vector<size_t>& out) {
+	batch_search(haystack.view(), needles.view(), out);
 }
 
 template<typename T>
@@ -39,4 +199,39 @@ T * binary_search(vector<T>& vec, const T& val) {
 	return binary_search(vec.view(), val);
 }
 
+template<typename T>
+const T * binary_search(const vector<T>& vec, const T& val) {
+	return binary_search(vec.view(), val);
+}
+
+template<typename T>
+T * lower_bound(vector<T>& vec, const T& val) {
+	return lower_bound(vec.view(), val);
+}
+
+template<typename T>
+const T * lower_bound(const vector<T>& vec, const T& val) {
+	return lower_bound(vec.view(), val);
+}
+
+template<typename T>
+T * upper_bound(vector<T>& vec, const T& val) {
+	return upper_bound(vec.view(), val);
+}
+
+template<typename T>
+const T * upper_bound(const vector<T>& vec, const T& val) {
+	return upper_bound(vec.view(), val);
+}
+
+template<typename T>
+pair<T*, T*> equal_range(vector<T>& vec, const T& val) {
+	return equal_range(vec.view(), val);
+}
+
+template<typename T>
+pair<const T*, const T*> equal_range(const vector<T>& vec, const T& val) {
+	return equal_range(vec.view(), val);
+}
+
 }
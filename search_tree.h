@@ -1,26 +1,151 @@
 #pragma once
 
+#include <iterator>
 #include <memory>
 
 #include "common.h"
+#include "vector.h"
 
 
 namespace algo {
 
+/// in-order iterator over search tree nodes, which link to their parents. it is
+/// two pointers and steps through the links, so a full scan is linear. end() keeps
+/// the root, so it can step back to the maximum.
+template<typename N, typename T>
+class tree_iterator {
+public:
+	using iterator_category = std::bidirectional_iterator_tag;
+	using value_type = T;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const T*;
+	using reference = const T&;
+
+	tree_iterator() = default;
+
+	/// at node n of the tree under root, end() if n is nullptr
+	tree_iterator(N * n, N * r) : cur(n), root(r) {}
+
+	/// the minimum of the tree under root
+	static tree_iterator begin(N * root) {
+		auto * n = root;
+		while (n != nullptr && n->left != nullptr) {
+			n = n->left.get();
+		}
+		return tree_iterator(n, root);
+	}
+
+	/// the first value not less than val
+	static tree_iterator lower_bound(N * root, const T& val) {
+		N * res = nullptr;
+		auto * n = root;
+		while (n != nullptr) {
+			if (n->val < val) {
+				n = n->right.get();
+			}
+			else {
+				res = n;
+				n = n->left.get();
+			}
+		}
+		return tree_iterator(res, root);
+	}
+
+	/// the first value greater than val
+	static tree_iterator upper_bound(N * root, const T& val) {
+		N * res = nullptr;
+		auto * n = root;
+		while (n != nullptr) {
+			if (val < n->val) {
+				res = n;
+				n = n->left.get();
+			}
+			else {
+				n = n->right.get();
+			}
+		}
+		return tree_iterator(res, root);
+	}
+
+	reference operator*() const {
+		return cur->val;
+	}
+
+	pointer operator->() const {
+		return &cur->val;
+	}
+
+	tree_iterator& operator++() {
+		if (cur->right != nullptr) {
+			cur = cur->right.get();
+			while (cur->left != nullptr) {
+				cur = cur->left.get();
+			}
+			return *this;
+		}
+		while (cur->parent != nullptr && cur->parent->right.get() == cur) {
+			cur = cur->parent;
+		}
+		cur = cur->parent;
+		return *this;
+	}
+
+	tree_iterator operator++(int) {
+		auto res = *this;
+		++*this;
+		return res;
+	}
+
+	tree_iterator& operator--() {
+		if (cur == nullptr) {
+			cur = root;
+			while (cur->right != nullptr) {
+				cur = cur->right.get();
+			}
+			return *this;
+		}
+		if (cur->left != nullptr) {
+			cur = cur->left.get();
+			while (cur->right != nullptr) {
+				cur = cur->right.get();
+			}
+			return *this;
+		}
+		while (cur->parent != nullptr && cur->parent->left.get() == cur) {
+			cur = cur->parent;
+		}
+		cur = cur->parent;
+		return *this;
+	}
+
+	tree_iterator operator--(int) {
+		auto res = *this;
+		--*this;
+		return res;
+	}
+
+	bool operator==(const tree_iterator& r) const {
+		return cur == r.cur;
+	}
+
+	bool operator!=(const tree_iterator& r) const {
+		return !(*this == r);
+	}
+
+private:
+	N * cur{nullptr};
+	N * root{nullptr};
+};
+
 template<typename T>
 class binary_tree {
 	struct node {
 		node() = delete;
-		node(const node& r) : val(r.val), left(std::make_unique<node>(*r.left.get())), right(std::make_unique<node>(*r.right.get())) {}
+		// copies would not know their parent, trees are copied by clone
+		node(const node&) = delete;
 		node(node&&) = default;
 		~node() = default;
-
-		node& operator=(const node& r) {
-			val = r.val;
-			left = std::make_unique<node>(*r.left.get());
-			right = std::make_unique<node>(*r.right.get());
-		}
-
+		node& operator=(const node&) = delete;
 		node& operator=(node&&) = default;
 
 		node(const T& v, std::unique_ptr<node> l = nullptr, std::unique_ptr<node> r = nullptr) : val(v), left(std::move(l)), right(std::move(r)) {}
@@ -46,18 +171,21 @@ class binary_tree {
 		T val;
 		std::unique_ptr<node> left;
 		std::unique_ptr<node> right;
+		node * parent{nullptr};
 	};
 public:
 	using type = T;
+	using iterator = tree_iterator<const node, T>;
 
 	binary_tree() = default;
-	binary_tree(const binary_tree& r) : head(std::make_unique<node>(*r.head.get())), cnt(r.cnt) {}
+	binary_tree(const binary_tree& r) : head(clone(r.head, nullptr)), cnt(r.cnt) {}
 	binary_tree(binary_tree&&) = default;
 	~binary_tree() = default;
 
 	binary_tree& operator=(const binary_tree& r) {
 		cnt = r.cnt;
-		head = std::make_unique<node>(*r.head.get());
+		head = clone(r.head, nullptr);
+		return *this;
 	}
 
 	binary_tree& operator=(binary_tree&&) = default;
@@ -96,6 +224,7 @@ public:
 				auto * l = tmp->left.get();
 				if (l == nullptr) {
 					tmp->left = std::make_unique<node>(val);
+					tmp->left->parent = tmp;
 					break;
 				}
 				tmp = l;
@@ -104,6 +233,7 @@ public:
 				auto * r = tmp->right.get();
 				if (r == nullptr) {
 					tmp->right = std::make_unique<node>(val);
+					tmp->right->parent = tmp;
 					break;
 				}
 				tmp = r;
@@ -152,14 +282,21 @@ public:
 					const auto lh = hight(tmp->left);
 					const auto rh = hight(tmp->right);
 					if (lh > rh) {
-						tmp->left->max_node()->right = std::move(tmp->right);
+						auto * m = tmp->left->max_node();
+						tmp->right->parent = m;
+						m->right = std::move(tmp->right);
 						n = std::move(tmp->left);
 					}
 					else {
-						tmp->right->min_node()->left = std::move(tmp->left);
+						auto * m = tmp->right->min_node();
+						tmp->left->parent = m;
+						m->left = std::move(tmp->left);
 						n = std::move(tmp->right);
 					}
 				}
+				if (n != nullptr) {
+					n->parent = last;
+				}
 				--cnt;
 				return true;
 			}
@@ -190,11 +327,354 @@ public:
 		return head == nullptr ? nullptr : &head->max_node()->val;
 	}
 
+	iterator begin() const {
+		return iterator::begin(head.get());
+	}
+
+	iterator end() const {
+		return iterator(nullptr, head.get());
+	}
+
+	iterator lower_bound(const T& val) const {
+		return iterator::lower_bound(head.get(), val);
+	}
+
+	iterator upper_bound(const T& val) const {
+		return iterator::upper_bound(head.get(), val);
+	}
+
+	/// values in [from, to)
+	iterator_range<iterator> range(const T& from, const T& to) const {
+		assert(!(to < from));
+		return iterator_range<iterator>(lower_bound(from), lower_bound(to));
+	}
+
 private:
 	static size_t hight(const std::unique_ptr<node>& n) {
 		return n == nullptr ? 0 : n->hight();
 	}
 
+	static std::unique_ptr<node> clone(const std::unique_ptr<node>& n, node * parent) {
+		if (n == nullptr) {
+			return nullptr;
+		}
+		auto res = std::make_unique<node>(n->val);
+		res->parent = parent;
+		res->left = clone(n->left, res.get());
+		res->right = clone(n->right, res.get());
+		return res;
+	}
+
+	std::unique_ptr<node> head{};
+	size_t cnt{0};
+};
+
+/// self-balancing (AVL) search tree with the same interface as binary_tree,
+/// every node keeps the hight of its subtree so rebalancing is O(log n)
+/// and the size of its subtree for rank and select
+template<typename T>
+class avl_tree {
+	struct node {
+		node() = delete;
+		node(const node&) = delete;
+		node(node&&) = default;
+		~node() = default;
+		node& operator=(const node&) = delete;
+		node& operator=(node&&) = default;
+
+		node(const T& v) : val(v) {}
+
+		bool is_leaf() const {
+			return left == nullptr && right == nullptr;
+		}
+
+		node * min_node() {
+			return left == nullptr ? this : left->min_node();
+		}
+
+		node * max_node() {
+			return right == nullptr ? this : right->max_node();
+		}
+
+		T val;
+		size_t hight{1};
+		size_t count{1};
+		std::unique_ptr<node> left{};
+		std::unique_ptr<node> right{};
+		node * parent{nullptr};
+	};
+public:
+	using type = T;
+	using iterator = tree_iterator<const node, T>;
+
+	avl_tree() = default;
+	avl_tree(const avl_tree& r) : head(clone(r.head)), cnt(r.cnt) {}
+	avl_tree(avl_tree&&) = default;
+	~avl_tree() = default;
+
+	avl_tree& operator=(const avl_tree& r) {
+		head = clone(r.head);
+		cnt = r.cnt;
+		return *this;
+	}
+
+	avl_tree& operator=(avl_tree&&) = default;
+
+	size_t size() const {
+		return cnt;
+	}
+
+	bool empty() const {
+		return cnt == 0;
+	}
+
+	size_t hight() const {
+		return hight(head);
+	}
+
+	void swap(avl_tree& r) {
+		using std::swap;
+		swap(head, r.head);
+		swap(cnt, r.cnt);
+	}
+
+	bool insert(const T& val) {
+		if (!insert(head, val)) {
+			return false;
+		}
+		head->parent = nullptr;
+		++cnt;
+		return true;
+	}
+
+	T * find(const T& val) {
+		auto * tmp = head.get();
+		while (tmp != nullptr) {
+			if (tmp->val == val) {
+				return &tmp->val;
+			}
+			tmp = val < tmp->val ? tmp->left.get() : tmp->right.get();
+		}
+		return nullptr;
+	}
+
+	/// the number of values less than val
+	size_t rank(const T& val) const {
+		size_t res = 0;
+		const auto * tmp = head.get();
+		while (tmp != nullptr) {
+			if (tmp->val < val) {
+				res += count(tmp->left) + 1;
+				tmp = tmp->right.get();
+			}
+			else {
+				tmp = tmp->left.get();
+			}
+		}
+		return res;
+	}
+
+	/// the k-th smallest value, counting from 0
+	const T * select(size_t k) const {
+		if (k >= cnt) {
+			return nullptr;
+		}
+		const auto * tmp = head.get();
+		while (true) {
+			const auto l = count(tmp->left);
+			if (k == l) {
+				return &tmp->val;
+			}
+			if (k < l) {
+				tmp = tmp->left.get();
+			}
+			else {
+				k -= l + 1;
+				tmp = tmp->right.get();
+			}
+		}
+	}
+
+	bool remove(const T& val) {
+		if (!remove(head, val)) {
+			return false;
+		}
+		if (head != nullptr) {
+			head->parent = nullptr;
+		}
+		--cnt;
+		return true;
+	}
+
+	T * min() {
+		return head == nullptr ? nullptr : &head->min_node()->val;
+	}
+
+	const T * min() const {
+		return head == nullptr ? nullptr : &head->min_node()->val;
+	}
+
+	T * max() {
+		return head == nullptr ? nullptr : &head->max_node()->val;
+	}
+
+	const T * max() const {
+		return head == nullptr ? nullptr : &head->max_node()->val;
+	}
+
+	iterator begin() const {
+		return iterator::begin(head.get());
+	}
+
+	iterator end() const {
+		return iterator(nullptr, head.get());
+	}
+
+	iterator lower_bound(const T& val) const {
+		return iterator::lower_bound(head.get(), val);
+	}
+
+	iterator upper_bound(const T& val) const {
+		return iterator::upper_bound(head.get(), val);
+	}
+
+	/// values in [from, to)
+	iterator_range<iterator> range(const T& from, const T& to) const {
+		assert(!(to < from));
+		return iterator_range<iterator>(lower_bound(from), lower_bound(to));
+	}
+
+private:
+	static size_t hight(const std::unique_ptr<node>& n) {
+		return n == nullptr ? 0 : n->hight;
+	}
+
+	static size_t count(const std::unique_ptr<node>& n) {
+		return n == nullptr ? 0 : n->count;
+	}
+
+	static std::unique_ptr<node> clone(const std::unique_ptr<node>& n) {
+		if (n == nullptr) {
+			return nullptr;
+		}
+		auto res = std::make_unique<node>(n->val);
+		res->hight = n->hight;
+		res->count = n->count;
+		res->left = clone(n->left);
+		res->right = clone(n->right);
+		adopt(*res);
+		return res;
+	}
+
+	/// points the children of n back to it
+	static void adopt(node& n) {
+		if (n.left != nullptr) {
+			n.left->parent = &n;
+		}
+		if (n.right != nullptr) {
+			n.right->parent = &n;
+		}
+	}
+
+	/// after the children of n changed, which every change of a link is followed by
+	static void update(node& n) {
+		const auto lh = hight(n.left);
+		const auto rh = hight(n.right);
+		n.hight = (lh > rh ? lh : rh) + 1;
+		n.count = count(n.left) + count(n.right) + 1;
+		adopt(n);
+	}
+
+	static void rotate_left(std::unique_ptr<node>& n) {
+		auto r = std::move(n->right);
+		n->right = std::move(r->left);
+		update(*n);
+		r->left = std::move(n);
+		n = std::move(r);
+		update(*n);
+	}
+
+	static void rotate_right(std::unique_ptr<node>& n) {
+		auto l = std::move(n->left);
+		n->left = std::move(l->right);
+		update(*n);
+		l->right = std::move(n);
+		n = std::move(l);
+		update(*n);
+	}
+
+	static void balance(std::unique_ptr<node>& n) {
+		update(*n);
+		const auto lh = hight(n->left);
+		const auto rh = hight(n->right);
+		if (lh > rh + 1) {
+			if (hight(n->left->left) < hight(n->left->right)) {
+				rotate_left(n->left);
+			}
+			rotate_right(n);
+		}
+		else if (rh > lh + 1) {
+			if (hight(n->right->right) < hight(n->right->left)) {
+				rotate_right(n->right);
+			}
+			rotate_left(n);
+		}
+	}
+
+	static bool insert(std::unique_ptr<node>& n, const T& val) {
+		if (n == nullptr) {
+			n = std::make_unique<node>(val);
+			return true;
+		}
+		if (n->val == val) {
+			return false;
+		}
+		if (!insert(val < n->val ? n->left : n->right, val)) {
+			return false;
+		}
+		balance(n);
+		return true;
+	}
+
+	/// detaches the minimal node of a non-empty subtree
+	static std::unique_ptr<node> remove_min(std::unique_ptr<node>& n) {
+		if (n->left == nullptr) {
+			auto res = std::move(n);
+			n = std::move(res->right);
+			return res;
+		}
+		auto res = remove_min(n->left);
+		balance(n);
+		return res;
+	}
+
+	static bool remove(std::unique_ptr<node>& n, const T& val) {
+		if (n == nullptr) {
+			return false;
+		}
+		if (n->val == val) {
+			if (n->left == nullptr) {
+				n = std::move(n->right); // might be nullptr
+			}
+			else if (n->right == nullptr) {
+				n = std::move(n->left);
+			}
+			else {
+				auto m = remove_min(n->right);
+				m->left = std::move(n->left);
+				m->right = std::move(n->right);
+				n = std::move(m);
+			}
+		}
+		else if (!remove(val < n->val ? n->left : n->right, val)) {
+			return false;
+		}
+		if (n != nullptr) {
+			balance(n);
+		}
+		return true;
+	}
+
 	std::unique_ptr<node> head{};
 	size_t cnt{0};
 };
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "common.h"
+#include "vector.h"
+#include "vector_view.h"
+#include "pair.h"
+#include "sort.h"
+
+
+namespace algo {
+
+/// splits v into [< pivot][== pivot][> pivot], returns bounds of the middle part
+template<typename T>
+pair<size_t, size_t> partition3(vector_view<T> v, const T& pivot) {
+	size_t lt = 0;
+	size_t i = 0;
+	size_t gt = v.size();
+	while (i < gt) {
+		if (v[i] < pivot) {
+			std::swap(v[lt], v[i]);
+			++lt;
+			++i;
+		}
+		else if (pivot < v[i]) {
+			--gt;
+			std::swap(v[i], v[gt]);
+		}
+		else {
+			++i;
+		}
+	}
+	return pair<size_t, size_t>(lt, gt);
+}
+
+template<typename T>
+void small_sort(vector_view<T> v) {
+	for (size_t i = 1; i < v.size(); ++i) {
+		auto cur = std::move(v[i]);
+		auto j = i;
+		while (j > 0 && cur < v[j - 1]) {
+			v[j] = std::move(v[j - 1]);
+			--j;
+		}
+		v[j] = std::move(cur);
+	}
+}
+
+template<typename T>
+size_t median3(vector_view<T> v, size_t a, size_t b, size_t c) {
+	if (v[a] < v[b]) {
+		return v[b] < v[c] ? b : (v[a] < v[c] ? c : a);
+	}
+	return v[a] < v[c] ? a : (v[b] < v[c] ? c : b);
+}
+
+template<typename T>
+void nth_element_mom(vector_view<T> v, size_t n);
+
+/// median of medians of groups of 5, the pivot that guarantees linear selection
+template<typename T>
+T median_of_medians(vector_view<T> v) {
+	size_t medians = 0;
+	for (size_t i = 0; i < v.size(); i += 5) {
+		const auto end = i + 5 < v.size() ? i + 5 : v.size();
+		auto group = v.view(i, end);
+		small_sort(group);
+		std::swap(v[medians], group[group.size() / 2]);
+		++medians;
+	}
+	auto front = v.view(0, medians);
+	nth_element_mom(front, medians / 2);
+	return front[medians / 2];
+}
+
+/// worst case linear selection, always pivots on the median of medians
+template<typename T>
+void nth_element_mom(vector_view<T> v, size_t n) {
+	assert(n < v.size());
+	size_t lo = 0;
+	size_t hi = v.size();
+	while (hi - lo > 5) {
+		auto cur = v.view(lo, hi);
+		const auto pivot = median_of_medians(cur);
+		const auto eq = partition3(cur, pivot);
+		if (n < lo + eq.first) {
+			hi = lo + eq.first;
+		}
+		else if (n >= lo + eq.second) {
+			lo = lo + eq.second;
+		}
+		else {
+			return;
+		}
+	}
+	small_sort(v.view(lo, hi));
+}
+
+template<typename T>
+void nth_element_mom(vector<T>& v, size_t n) {
+	nth_element_mom(v.view(), n);
+}
+
+/// introselect: quickselect with median of 3 pivots, falls back to
+/// the median of medians once it stops converging, so the worst case stays linear.
+/// afterwards v[n] is the element that would be there if v was sorted,
+/// everything before it is not greater and everything after it is not less.
+template<typename T>
+void nth_element(vector_view<T> v, size_t n) {
+	assert(n < v.size());
+	size_t lo = 0;
+	size_t hi = v.size();
+	size_t budget = 0;
+	for (size_t s = v.size(); s > 1; s /= 2) {
+		budget += 2;
+	}
+
+	while (hi - lo > 16) {
+		if (budget == 0) {
+			nth_element_mom(v.view(lo, hi), n - lo);
+			return;
+		}
+		--budget;
+
+		auto cur = v.view(lo, hi);
+		const auto last = cur.size() - 1;
+		const auto pivot = cur[median3(cur, 0, last / 2, last)];
+		const auto eq = partition3(cur, pivot);
+		if (n < lo + eq.first) {
+			hi = lo + eq.first;
+		}
+		else if (n >= lo + eq.second) {
+			lo = lo + eq.second;
+		}
+		else {
+			return;
+		}
+	}
+	small_sort(v.view(lo, hi));
+}
+
+template<typename T>
+void nth_element(vector<T>& v, size_t n) {
+	nth_element(v.view(), n);
+}
+
+/// sorts only the k smallest elements into v[0, k), the rest is left in unspecified order
+template<typename T>
+void partial_sort(vector_view<T> v, size_t k) {
+	if (k == 0) {
+		return;
+	}
+	if (k < v.size()) {
+		nth_element(v, k);
+	}
+	else {
+		k = v.size();
+	}
+	quick_sort(v.view(0, k), random_pivot_strategy<T>);
+}
+
+template<typename T>
+void partial_sort(vector<T>& v, size_t k) {
+	partial_sort(v.view(), k);
+}
+
+/// the k smallest elements of v in unspecified order, v itself is not modified
+template<typename T>
+vector<view_value_t<T>> select_k(vector_view<T> v, size_t k) {
+	using V = view_value_t<T>;
+	vector<V> tmp(vector_view<const V>(v.data(), v.size()));
+	if (k < tmp.size()) {
+		nth_element(tmp, k);
+	}
+	else {
+		k = tmp.size();
+	}
+
+	vector<V> res;
+	res.reserve(k);
+	for (size_t i = 0; i < k; ++i) {
+		res.push_back(std::move(tmp[i]));
+	}
+	return res;
+}
+
+template<typename T>
+vector<T> select_k(const vector<T>& v, size_t k) {
+	return select_k(v.view(), k);
+}
+
+}
@@ -0,0 +1,276 @@
+#pragma once
+
+#include <type_traits>
+#include <cstdint>
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+#include "common.h"
+#include "vector.h"
+
+
+namespace algo {
+
+#ifdef __x86_64__
+
+inline bool has_avx2() {
+	static const bool res = __builtin_cpu_supports("avx2");
+	return res;
+}
+
+inline bool has_avx512() {
+	static const bool res = __builtin_cpu_supports("avx512f");
+	return res;
+}
+
+/// equality of 32 bytes of T against a broadcast value as a byte mask,
+/// every matching element sets all sizeof(T) of its bits
+template<typename T, typename Enable = void>
+struct simd_eq {
+	static const bool enabled = false;
+};
+
+template<typename T>
+struct simd_eq<T, typename std::enable_if<std::is_integral<T>::value && sizeof(T) == 1>::type> {
+	static const bool enabled = true;
+
+	__attribute__((target("avx2")))
+	static uint32_t avx2(const T * p, T val) {
+		const auto k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		return _mm256_movemask_epi8(_mm256_cmpeq_epi8(k, _mm256_set1_epi8(val)));
+	}
+};
+
+template<typename T>
+struct simd_eq<T, typename std::enable_if<std::is_integral<T>::value && sizeof(T) == 2>::type> {
+	static const bool enabled = true;
+
+	__attribute__((target("avx2")))
+	static uint32_t avx2(const T * p, T val) {
+		const auto k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		return _mm256_movemask_epi8(_mm256_cmpeq_epi16(k, _mm256_set1_epi16(val)));
+	}
+};
+
+template<typename T>
+struct simd_eq<T, typename std::enable_if<std::is_integral<T>::value && sizeof(T) == 4>::type> {
+	static const bool enabled = true;
+
+	__attribute__((target("avx2")))
+	static uint32_t avx2(const T * p, T val) {
+		const auto k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		return _mm256_movemask_epi8(_mm256_cmpeq_epi32(k, _mm256_set1_epi32(val)));
+	}
+};
+
+template<typename T>
+struct simd_eq<T, typename std::enable_if<std::is_integral<T>::value && sizeof(T) == 8>::type> {
+	static const bool enabled = true;
+
+	__attribute__((target("avx2")))
+	static uint32_t avx2(const T * p, T val) {
+		const auto k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		return _mm256_movemask_epi8(_mm256_cmpeq_epi64(k, _mm256_set1_epi64x(val)));
+	}
+};
+
+/// ordered comparison, so like operator== NaN never matches and -0.0 matches 0.0
+template<>
+struct simd_eq<float> {
+	static const bool enabled = true;
+
+	__attribute__((target("avx2")))
+	static uint32_t avx2(const float * p, float val) {
+		const auto eq = _mm256_cmp_ps(_mm256_loadu_ps(p), _mm256_set1_ps(val), _CMP_EQ_OQ);
+		return _mm256_movemask_epi8(_mm256_castps_si256(eq));
+	}
+};
+
+template<>
+struct simd_eq<double> {
+	static const bool enabled = true;
+
+	__attribute__((target("avx2")))
+	static uint32_t avx2(const double * p, double val) {
+		const auto eq = _mm256_cmp_pd(_mm256_loadu_pd(p), _mm256_set1_pd(val), _CMP_EQ_OQ);
+		return _mm256_movemask_epi8(_mm256_castpd_si256(eq));
+	}
+};
+
+/// index of the first element equal to val or n, 4 vectors are compared per iteration
+template<typename T>
+__attribute__((target("avx2")))
+size_t find_first_avx2(const T * arr, size_t n, T val) {
+	using E = simd_eq<T>;
+	const size_t step = 32 / sizeof(T);
+	size_t i = 0;
+	for (; i + 4 * step <= n; i += 4 * step) {
+		const auto m0 = E::avx2(arr + i, val);
+		const auto m1 = E::avx2(arr + i + step, val);
+		const auto m2 = E::avx2(arr + i + 2 * step, val);
+		const auto m3 = E::avx2(arr + i + 3 * step, val);
+		if ((m0 | m1 | m2 | m3) != 0) {
+			const uint64_t lo = m0 | static_cast<uint64_t>(m1) << 32;
+			if (lo != 0) {
+				return i + __builtin_ctzll(lo) / sizeof(T);
+			}
+			const uint64_t hi = m2 | static_cast<uint64_t>(m3) << 32;
+			return i + 2 * step + __builtin_ctzll(hi) / sizeof(T);
+		}
+	}
+	for (; i + step <= n; i += step) {
+		const auto m = E::avx2(arr + i, val);
+		if (m != 0) {
+			return i + __builtin_ctz(m) / sizeof(T);
+		}
+	}
+	for (; i < n; ++i) {
+		if (arr[i] == val) {
+			return i;
+		}
+	}
+	return n;
+}
+
+template<typename T>
+__attribute__((target("avx2,popcnt")))
+size_t count_equal_avx2(const T * arr, size_t n, T val) {
+	using E = simd_eq<T>;
+	const size_t step = 32 / sizeof(T);
+	size_t bits = 0;
+	size_t i = 0;
+	for (; i + step <= n; i += step) {
+		bits += __builtin_popcount(E::avx2(arr + i, val));
+	}
+	size_t res = bits / sizeof(T);
+	for (; i < n; ++i) {
+		res += arr[i] == val;
+	}
+	return res;
+}
+
+template<typename T>
+__attribute__((target("avx2")))
+void find_all_avx2(const T * arr, size_t n, T val, vector<size_t>& out) {
+	using E = simd_eq<T>;
+	const size_t step = 32 / sizeof(T);
+	const uint32_t lane = sizeof(T) == 4 ? 0xf : (sizeof(T) == 8 ? 0xff : (sizeof(T) == 2 ? 0x3 : 0x1));
+	size_t i = 0;
+	for (; i + step <= n; i += step) {
+		auto m = E::avx2(arr + i, val);
+		while (m != 0) {
+			const auto bit = __builtin_ctz(m);
+			out.push_back(i + bit / sizeof(T));
+			m &= ~(lane << bit);
+		}
+	}
+	for (; i < n; ++i) {
+		if (arr[i] == val) {
+			out.push_back(i);
+		}
+	}
+}
+
+#else
+
+inline bool has_avx2() {
+	return false;
+}
+
+inline bool has_avx512() {
+	return false;
+}
+
+template<typename T>
+struct simd_eq {
+	static const bool enabled = false;
+};
+
+#endif
+
+/// index of the first element equal to val or n. blocks are scanned without
+/// an early exit, so compilers turn the inner loop into vector compares.
+template<typename T>
+size_t find_first_scalar(const T * arr, size_t n, const T& val) {
+	const size_t block = 16;
+	size_t i = 0;
+	for (; i + block <= n; i += block) {
+		unsigned any = 0;
+		for (size_t k = 0; k < block; ++k) {
+			any |= arr[i + k] == val;
+		}
+		if (any) {
+			break;
+		}
+	}
+	for (; i < n; ++i) {
+		if (arr[i] == val) {
+			return i;
+		}
+	}
+	return n;
+}
+
+template<typename T>
+size_t count_equal_scalar(const T * arr, size_t n, const T& val) {
+	size_t res = 0;
+	for (size_t i = 0; i < n; ++i) {
+		res += arr[i] == val;
+	}
+	return res;
+}
+
+template<typename T>
+void find_all_scalar(const T * arr, size_t n, const T& val, vector<size_t>& out) {
+	for (size_t i = 0; i < n; ++i) {
+		if (arr[i] == val) {
+			out.push_back(i);
+		}
+	}
+}
+
+template<typename T>
+size_t find_first(const T * arr, size_t n, const T& val, std::false_type) {
+	return find_first_scalar(arr, n, val);
+}
+
+template<typename T>
+size_t count_equal(const T * arr, size_t n, const T& val, std::false_type) {
+	return count_equal_scalar(arr, n, val);
+}
+
+template<typename T>
+void find_all(const T * arr, size_t n, const T& val, vector<size_t>& out, std::false_type) {
+	find_all_scalar(arr, n, val, out);
+}
+
+#ifdef __x86_64__
+
+template<typename T>
+size_t find_first(const T * arr, size_t n, const T& val, std::true_type) {
+	return has_avx2() ? find_first_avx2(arr, n, val) : find_first_scalar(arr, n, val);
+}
+
+template<typename T>
+size_t count_equal(const T * arr, size_t n, const T& val, std::true_type) {
+	return has_avx2() ? count_equal_avx2(arr, n, val) : count_equal_scalar(arr, n, val);
+}
+
+template<typename T>
+void find_all(const T * arr, size_t n, const T& val, vector<size_t>& out, std::true_type) {
+	if (has_avx2()) {
+		find_all_avx2(arr, n, val, out);
+	}
+	else {
+		find_all_scalar(arr, n, val, out);
+	}
+}
+
+#endif
+
+template<typename T>
+using simd_enabled = std::integral_constant<bool, simd_eq<T>::enabled>;
+
+}
@@ -0,0 +1,764 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+#include "common.h"
+#include "vector.h"
+#include "vector_view.h"
+#include "sort_stats.h"
+#include "simd.h"
+#include "sort.h"
+
+
+namespace algo {
+
+/// the keys simd_quick_sort takes: 32 bit integers, signed 64 bit integers, floats and doubles
+template<typename T>
+using is_simd_sort_key = std::integral_constant<bool,
+	(std::is_integral<T>::value && sizeof(T) == 4) ||
+	(std::is_integral<T>::value && std::is_signed<T>::value && sizeof(T) == 8) ||
+	std::is_same<T, float>::value || std::is_same<T, double>::value>;
+
+/// ranges up to this size are left to the small sort of a kernel
+const size_t simd_sort_base = 32;
+
+/// moves the elements of a[0, n) that are less than pivot, or not greater with or_equal,
+/// to the front and returns their number. no branches on the keys.
+template<typename T>
+size_t scalar_partition(T * a, size_t n, T pivot, bool or_equal) {
+	size_t m = 0;
+	for (size_t i = 0; i < n; ++i) {
+		const auto x = a[i];
+		const auto left = or_equal ? !(pivot < x) : x < pivot;
+		a[i] = a[m];
+		a[m] = x;
+		m += left;
+	}
+	return m;
+}
+
+/// a partition and a small sort for simd_quick_sort, without simd
+template<typename T>
+struct scalar_sort_kernel {
+	static size_t partition(T * a, size_t n, T pivot, bool or_equal) {
+		return scalar_partition(a, n, pivot, or_equal);
+	}
+
+	static void small_sort(T * a, size_t n) {
+		insertion_sort(vector_view<T>(a, n));
+	}
+};
+
+#ifdef __x86_64__
+
+/// the operations on 256 bit vectors of T the avx2 kernels are made of.
+/// left(x, p, or_equal) has a bit for each lane of x that is less than, or not greater than, p.
+/// permute and blend take indexes and masks of 32 bit elements, 64 bit lanes are 2 of them.
+template<typename T, typename Enable = void>
+struct simd_sort_avx2;
+
+/// 256 bit integer vectors of 32 or 64 bit lanes
+template<typename T>
+struct simd_sort_avx2_si256 {
+	using vec = __m256i;
+
+	__attribute__((target("avx2")))
+	static vec load(const T * p) {
+		return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+	}
+
+	__attribute__((target("avx2")))
+	static void store(T * p, vec x) {
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(p), x);
+	}
+
+	__attribute__((target("avx2")))
+	static vec permute(vec x, __m256i idx) {
+		return _mm256_permutevar8x32_epi32(x, idx);
+	}
+
+	__attribute__((target("avx2")))
+	static vec blend(vec a, vec b, __m256i mask) {
+		return _mm256_blendv_epi8(a, b, mask);
+	}
+};
+
+template<typename T>
+struct simd_sort_avx2<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value && sizeof(T) == 4>::type> : simd_sort_avx2_si256<T> {
+	using vec = __m256i;
+
+	static const size_t lanes = 8;
+
+	__attribute__((target("avx2")))
+	static vec set1(T x) {
+		return _mm256_set1_epi32(x);
+	}
+
+	__attribute__((target("avx2")))
+	static vec min(vec a, vec b) {
+		return _mm256_min_epi32(a, b);
+	}
+
+	__attribute__((target("avx2")))
+	static vec max(vec a, vec b) {
+		return _mm256_max_epi32(a, b);
+	}
+
+	__attribute__((target("avx2")))
+	static unsigned left(vec x, vec p, bool or_equal) {
+		if (or_equal) {
+			return ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(x, p))) & 0xff;
+		}
+		return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(p, x)));
+	}
+};
+
+/// unsigned keys with the sign bit flipped compare like signed ones
+template<typename T>
+struct simd_sort_avx2<T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value && sizeof(T) == 4>::type> : simd_sort_avx2_si256<T> {
+	using vec = __m256i;
+
+	static const size_t lanes = 8;
+
+	__attribute__((target("avx2")))
+	static vec set1(T x) {
+		return _mm256_set1_epi32(static_cast<int>(x));
+	}
+
+	__attribute__((target("avx2")))
+	static vec min(vec a, vec b) {
+		return _mm256_min_epu32(a, b);
+	}
+
+	__attribute__((target("avx2")))
+	static vec max(vec a, vec b) {
+		return _mm256_max_epu32(a, b);
+	}
+
+	__attribute__((target("avx2")))
+	static unsigned left(vec x, vec p, bool or_equal) {
+		const auto sign = _mm256_set1_epi32(static_cast<int>(0x80000000u));
+		return simd_sort_avx2<int32_t>::left(_mm256_xor_si256(x, sign), _mm256_xor_si256(p, sign), or_equal);
+	}
+};
+
+template<typename T>
+struct simd_sort_avx2<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value && sizeof(T) == 8>::type> : simd_sort_avx2_si256<T> {
+	using vec = __m256i;
+
+	static const size_t lanes = 4;
+
+	__attribute__((target("avx2")))
+	static vec set1(T x) {
+		return _mm256_set1_epi64x(x);
+	}
+
+	__attribute__((target("avx2")))
+	static vec min(vec a, vec b) {
+		return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b));
+	}
+
+	__attribute__((target("avx2")))
+	static vec max(vec a, vec b) {
+		return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b));
+	}
+
+	__attribute__((target("avx2")))
+	static unsigned left(vec x, vec p, bool or_equal) {
+		if (or_equal) {
+			return ~_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(x, p))) & 0xf;
+		}
+		return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(p, x)));
+	}
+};
+
+/// ordered comparisons, there must not be NaNs
+template<>
+struct simd_sort_avx2<float> {
+	using vec = __m256;
+
+	static const size_t lanes = 8;
+
+	__attribute__((target("avx2")))
+	static vec load(const float * p) {
+		return _mm256_loadu_ps(p);
+	}
+
+	__attribute__((target("avx2")))
+	static void store(float * p, vec x) {
+		_mm256_storeu_ps(p, x);
+	}
+
+	__attribute__((target("avx2")))
+	static vec set1(float x) {
+		return _mm256_set1_ps(x);
+	}
+
+	__attribute__((target("avx2")))
+	static vec min(vec a, vec b) {
+		return _mm256_min_ps(a, b);
+	}
+
+	__attribute__((target("avx2")))
+	static vec max(vec a, vec b) {
+		return _mm256_max_ps(a, b);
+	}
+
+	__attribute__((target("avx2")))
+	static unsigned left(vec x, vec p, bool or_equal) {
+		return _mm256_movemask_ps(or_equal ? _mm256_cmp_ps(x, p, _CMP_LE_OQ) : _mm256_cmp_ps(x, p, _CMP_LT_OQ));
+	}
+
+	__attribute__((target("avx2")))
+	static vec permute(vec x, __m256i idx) {
+		return _mm256_permutevar8x32_ps(x, idx);
+	}
+
+	__attribute__((target("avx2")))
+	static vec blend(vec a, vec b, __m256i mask) {
+		return _mm256_blendv_ps(a, b, _mm256_castsi256_ps(mask));
+	}
+};
+
+template<>
+struct simd_sort_avx2<double> {
+	using vec = __m256d;
+
+	static const size_t lanes = 4;
+
+	__attribute__((target("avx2")))
+	static vec load(const double * p) {
+		return _mm256_loadu_pd(p);
+	}
+
+	__attribute__((target("avx2")))
+	static void store(double * p, vec x) {
+		_mm256_storeu_pd(p, x);
+	}
+
+	__attribute__((target("avx2")))
+	static vec set1(double x) {
+		return _mm256_set1_pd(x);
+	}
+
+	__attribute__((target("avx2")))
+	static vec min(vec a, vec b) {
+		return _mm256_min_pd(a, b);
+	}
+
+	__attribute__((target("avx2")))
+	static vec max(vec a, vec b) {
+		return _mm256_max_pd(a, b);
+	}
+
+	__attribute__((target("avx2")))
+	static unsigned left(vec x, vec p, bool or_equal) {
+		return _mm256_movemask_pd(or_equal ? _mm256_cmp_pd(x, p, _CMP_LE_OQ) : _mm256_cmp_pd(x, p, _CMP_LT_OQ));
+	}
+
+	__attribute__((target("avx2")))
+	static vec permute(vec x, __m256i idx) {
+		return _mm256_castps_pd(_mm256_permutevar8x32_ps(_mm256_castpd_ps(x), idx));
+	}
+
+	__attribute__((target("avx2")))
+	static vec blend(vec a, vec b, __m256i mask) {
+		return _mm256_blendv_pd(a, b, _mm256_castsi256_pd(mask));
+	}
+};
+
+/// for every mask of left lanes the permutation of 32 bit elements that moves
+/// the left lanes to the front and the others behind them, both in order
+template<size_t Lanes>
+struct simd_partition_table {
+	simd_partition_table() {
+		const size_t width = 8 / Lanes;
+		for (size_t m = 0; m < (1 << Lanes); ++m) {
+			size_t k = 0;
+			for (size_t side = 0; side < 2; ++side) {
+				for (size_t l = 0; l < Lanes; ++l) {
+					if (((m >> l) & 1) == 1 - side) {
+						for (size_t e = 0; e < width; ++e) {
+							idx[m][k++] = static_cast<int32_t>(l * width + e);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	alignas(32) int32_t idx[1 << Lanes][8];
+};
+
+template<size_t Lanes>
+const simd_partition_table<Lanes>& partition_table() {
+	static const simd_partition_table<Lanes> res;
+	return res;
+}
+
+/// puts the lanes of x that go left to a[lw, ..) and the others to a[.., rw).
+/// both stores write a whole vector, the lanes that do not belong there are overwritten later.
+template<typename T>
+__attribute__((target("avx2,popcnt"), always_inline))
+inline void partition_vector_avx2(T * a, size_t& lw, size_t& rw, typename simd_sort_avx2<T>::vec x,
+		typename simd_sort_avx2<T>::vec p, bool or_equal, const simd_partition_table<simd_sort_avx2<T>::lanes>& table) {
+	using S = simd_sort_avx2<T>;
+	const size_t lanes = S::lanes;
+	const auto m = S::left(x, p, or_equal);
+	const auto y = S::permute(x, _mm256_load_si256(reinterpret_cast<const __m256i*>(table.idx[m])));
+	S::store(a + lw, y);
+	S::store(a + rw - lanes, y);
+	const auto l = static_cast<size_t>(__builtin_popcount(m));
+	lw += l;
+	rw -= lanes - l;
+}
+
+/// vectors read and partitioned at a time by the simd partitions
+const size_t simd_partition_unroll = 4;
+
+/// scalar_partition with avx2: a block of vectors from each end is held back, so that
+/// there is room for a block on both sides, and the next block is read from the side with
+/// less room (Bramas). a permutation from a table moves the lanes of a vector apart,
+/// which is then stored to both sides. blocks of several vectors mean fewer branches
+/// on the side, which are hard to predict.
+template<typename T>
+__attribute__((target("avx2,popcnt")))
+size_t simd_partition_avx2(T * a, size_t n, T pivot, bool or_equal) {
+	using S = simd_sort_avx2<T>;
+	const size_t lanes = S::lanes;
+	const size_t block = simd_partition_unroll * lanes;
+	if (n < 2 * block) {
+		return scalar_partition(a, n, pivot, or_equal);
+	}
+	const auto& table = partition_table<S::lanes>();
+	const auto p = S::set1(pivot);
+	typename S::vec first[simd_partition_unroll];
+	typename S::vec last[simd_partition_unroll];
+	for (size_t u = 0; u < simd_partition_unroll; ++u) {
+		first[u] = S::load(a + u * lanes);
+		last[u] = S::load(a + n - block + u * lanes);
+	}
+	size_t lr = block;
+	size_t rr = n - block;
+	size_t lw = 0;
+	size_t rw = n;
+	while (rr - lr >= block) {
+		T * from = nullptr;
+		if (lr - lw <= rw - rr) {
+			from = a + lr;
+			lr += block;
+		}
+		else {
+			rr -= block;
+			from = a + rr;
+		}
+		// all loaded before the first store, which may go where they were
+		typename S::vec x[simd_partition_unroll];
+		for (size_t u = 0; u < simd_partition_unroll; ++u) {
+			x[u] = S::load(from + u * lanes);
+		}
+		for (size_t u = 0; u < simd_partition_unroll; ++u) {
+			partition_vector_avx2(a, lw, rw, x[u], p, or_equal, table);
+		}
+	}
+
+	// the rest is saved first, everything between lw and rw is free then
+	T rest[simd_partition_unroll * 8];
+	const auto k = rr - lr;
+	std::copy(a + lr, a + rr, rest);
+	for (size_t i = 0; i < k; ++i) {
+		const auto left = or_equal ? !(pivot < rest[i]) : rest[i] < pivot;
+		if (left) {
+			a[lw++] = rest[i];
+		}
+		else {
+			a[--rw] = rest[i];
+		}
+	}
+	for (size_t u = 0; u < simd_partition_unroll; ++u) {
+		partition_vector_avx2(a, lw, rw, first[u], p, or_equal, table);
+		partition_vector_avx2(a, lw, rw, last[u], p, or_equal, table);
+	}
+	return lw;
+}
+
+/// the 32 bit element indexes of a permutation that swaps lanes l and l ^ j
+template<size_t Lanes>
+__attribute__((target("avx2")))
+__m256i bitonic_partner(size_t j) {
+	const size_t width = 8 / Lanes;
+	alignas(32) int32_t idx[8];
+	for (size_t e = 0; e < 8; ++e) {
+		idx[e] = static_cast<int32_t>(((e / width) ^ j) * width + e % width);
+	}
+	return _mm256_load_si256(reinterpret_cast<const __m256i*>(idx));
+}
+
+/// all bits of the 32 bit elements of the lanes whose index has bit set, none for bits past the lanes
+template<size_t Lanes>
+__attribute__((target("avx2")))
+__m256i lane_mask(size_t bit) {
+	const size_t width = 8 / Lanes;
+	alignas(32) int32_t mask[8];
+	for (size_t e = 0; e < 8; ++e) {
+		mask[e] = ((e / width) & bit) != 0 ? -1 : 0;
+	}
+	return _mm256_load_si256(reinterpret_cast<const __m256i*>(mask));
+}
+
+/// sorts a[0, n), n up to simd_sort_base, by a bitonic network on avx2 registers.
+/// the keys are padded to a power of two number of vectors with the largest key.
+/// compare-exchanges of lanes in different vectors are a min and a max, of lanes
+/// in the same vector a permutation, a min, a max and a blend.
+template<typename T>
+__attribute__((target("avx2")))
+void bitonic_sort_avx2(T * a, size_t n) {
+	using S = simd_sort_avx2<T>;
+	const size_t lanes = S::lanes;
+	const size_t max_vectors = simd_sort_base / 4;
+	assert(n <= simd_sort_base);
+	if (n <= 1) {
+		return;
+	}
+	size_t count = 1;
+	while (count * lanes < n) {
+		count *= 2;
+	}
+	const auto total = count * lanes;
+	T buf[simd_sort_base];
+	std::copy(a, a + n, buf);
+	std::fill(buf + n, buf + total, std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max());
+	typename S::vec r[max_vectors];
+	for (size_t x = 0; x < count; ++x) {
+		r[x] = S::load(buf + x * lanes);
+	}
+
+	for (size_t k = 2; k <= total; k *= 2) {
+		for (auto j = k / 2; j > 0; j /= 2) {
+			if (j >= lanes) {
+				// blocks of k are sorted up and down in turn
+				const auto jr = j / lanes;
+				for (size_t x = 0; x < count; ++x) {
+					if ((x & jr) != 0) {
+						continue;
+					}
+					const auto y = x | jr;
+					const auto lo = S::min(r[x], r[y]);
+					const auto hi = S::max(r[x], r[y]);
+					const auto up = (x * lanes & k) == 0;
+					r[x] = up ? lo : hi;
+					r[y] = up ? hi : lo;
+				}
+				continue;
+			}
+			// a lane keeps the max if it is the upper one of its pair in a block sorted up,
+			// or the lower one in a block sorted down
+			const auto partner = bitonic_partner<S::lanes>(j);
+			const auto upper = _mm256_xor_si256(lane_mask<S::lanes>(j), lane_mask<S::lanes>(k));
+			const auto all = _mm256_set1_epi32(-1);
+			for (size_t x = 0; x < count; ++x) {
+				const auto down = k >= lanes && (x * lanes & k) != 0;
+				const auto p = S::permute(r[x], partner);
+				r[x] = S::blend(S::min(r[x], p), S::max(r[x], p), down ? _mm256_xor_si256(upper, all) : upper);
+			}
+		}
+	}
+
+	for (size_t x = 0; x < count; ++x) {
+		S::store(buf + x * lanes, r[x]);
+	}
+	std::copy(buf, buf + n, a);
+}
+
+template<typename T>
+struct avx2_sort_kernel {
+	static size_t partition(T * a, size_t n, T pivot, bool or_equal) {
+		return simd_partition_avx2(a, n, pivot, or_equal);
+	}
+
+	static void small_sort(T * a, size_t n) {
+		bitonic_sort_avx2(a, n);
+	}
+};
+
+/// the operations on 512 bit vectors of T the avx512 partition is made of
+template<typename T, typename Enable = void>
+struct simd_sort_avx512;
+
+template<typename T>
+struct simd_sort_avx512<T, typename std::enable_if<std::is_integral<T>::value && sizeof(T) == 4>::type> {
+	using vec = __m512i;
+
+	static const size_t lanes = 16;
+
+	__attribute__((target("avx512f")))
+	static vec load(const T * p) {
+		return _mm512_loadu_si512(p);
+	}
+
+	__attribute__((target("avx512f")))
+	static vec set1(T x) {
+		return _mm512_set1_epi32(static_cast<int>(x));
+	}
+
+	__attribute__((target("avx512f")))
+	static unsigned left(vec x, vec p, bool or_equal) {
+		if (std::is_signed<T>::value) {
+			return or_equal ? _mm512_cmp_epi32_mask(x, p, _MM_CMPINT_LE) : _mm512_cmp_epi32_mask(x, p, _MM_CMPINT_LT);
+		}
+		return or_equal ? _mm512_cmp_epu32_mask(x, p, _MM_CMPINT_LE) : _mm512_cmp_epu32_mask(x, p, _MM_CMPINT_LT);
+	}
+
+	__attribute__((target("avx512f")))
+	static void compress_store(T * p, unsigned mask, vec x) {
+		_mm512_mask_compressstoreu_epi32(p, static_cast<__mmask16>(mask), x);
+	}
+};
+
+template<typename T>
+struct simd_sort_avx512<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value && sizeof(T) == 8>::type> {
+	using vec = __m512i;
+
+	static const size_t lanes = 8;
+
+	__attribute__((target("avx512f")))
+	static vec load(const T * p) {
+		return _mm512_loadu_si512(p);
+	}
+
+	__attribute__((target("avx512f")))
+	static vec set1(T x) {
+		return _mm512_set1_epi64(x);
+	}
+
+	__attribute__((target("avx512f")))
+	static unsigned left(vec x, vec p, bool or_equal) {
+		return or_equal ? _mm512_cmp_epi64_mask(x, p, _MM_CMPINT_LE) : _mm512_cmp_epi64_mask(x, p, _MM_CMPINT_LT);
+	}
+
+	__attribute__((target("avx512f")))
+	static void compress_store(T * p, unsigned mask, vec x) {
+		_mm512_mask_compressstoreu_epi64(p, static_cast<__mmask8>(mask), x);
+	}
+};
+
+template<>
+struct simd_sort_avx512<float> {
+	using vec = __m512;
+
+	static const size_t lanes = 16;
+
+	__attribute__((target("avx512f")))
+	static vec load(const float * p) {
+		return _mm512_loadu_ps(p);
+	}
+
+	__attribute__((target("avx512f")))
+	static vec set1(float x) {
+		return _mm512_set1_ps(x);
+	}
+
+	__attribute__((target("avx512f")))
+	static unsigned left(vec x, vec p, bool or_equal) {
+		return or_equal ? _mm512_cmp_ps_mask(x, p, _CMP_LE_OQ) : _mm512_cmp_ps_mask(x, p, _CMP_LT_OQ);
+	}
+
+	__attribute__((target("avx512f")))
+	static void compress_store(float * p, unsigned mask, vec x) {
+		_mm512_mask_compressstoreu_ps(p, static_cast<__mmask16>(mask), x);
+	}
+};
+
+template<>
+struct simd_sort_avx512<double> {
+	using vec = __m512d;
+
+	static const size_t lanes = 8;
+
+	__attribute__((target("avx512f")))
+	static vec load(const double * p) {
+		return _mm512_loadu_pd(p);
+	}
+
+	__attribute__((target("avx512f")))
+	static vec set1(double x) {
+		return _mm512_set1_pd(x);
+	}
+
+	__attribute__((target("avx512f")))
+	static unsigned left(vec x, vec p, bool or_equal) {
+		return or_equal ? _mm512_cmp_pd_mask(x, p, _CMP_LE_OQ) : _mm512_cmp_pd_mask(x, p, _CMP_LT_OQ);
+	}
+
+	__attribute__((target("avx512f")))
+	static void compress_store(double * p, unsigned mask, vec x) {
+		_mm512_mask_compressstoreu_pd(p, static_cast<__mmask8>(mask), x);
+	}
+};
+
+template<typename T>
+__attribute__((target("avx512f,popcnt"), always_inline))
+inline void partition_vector_avx512(T * a, size_t& lw, size_t& rw, typename simd_sort_avx512<T>::vec x,
+		typename simd_sort_avx512<T>::vec p, bool or_equal) {
+	using S = simd_sort_avx512<T>;
+	const size_t lanes = S::lanes;
+	const auto all = (1u << lanes) - 1;
+	const auto m = S::left(x, p, or_equal);
+	const auto l = static_cast<size_t>(__builtin_popcount(m));
+	S::compress_store(a + lw, m, x);
+	S::compress_store(a + rw - (lanes - l), ~m & all, x);
+	lw += l;
+	rw -= lanes - l;
+}
+
+/// simd_partition_avx2 with avx512, the lanes are stored to both sides by compress stores
+template<typename T>
+__attribute__((target("avx512f,popcnt")))
+size_t simd_partition_avx512(T * a, size_t n, T pivot, bool or_equal) {
+	using S = simd_sort_avx512<T>;
+	const size_t lanes = S::lanes;
+	const size_t block = simd_partition_unroll * lanes;
+	if (n < 2 * block) {
+		return scalar_partition(a, n, pivot, or_equal);
+	}
+	const auto p = S::set1(pivot);
+	typename S::vec first[simd_partition_unroll];
+	typename S::vec last[simd_partition_unroll];
+	for (size_t u = 0; u < simd_partition_unroll; ++u) {
+		first[u] = S::load(a + u * lanes);
+		last[u] = S::load(a + n - block + u * lanes);
+	}
+	size_t lr = block;
+	size_t rr = n - block;
+	size_t lw = 0;
+	size_t rw = n;
+	while (rr - lr >= block) {
+		T * from = nullptr;
+		if (lr - lw <= rw - rr) {
+			from = a + lr;
+			lr += block;
+		}
+		else {
+			rr -= block;
+			from = a + rr;
+		}
+		// all loaded before the first store, which may go where they were
+		typename S::vec x[simd_partition_unroll];
+		for (size_t u = 0; u < simd_partition_unroll; ++u) {
+			x[u] = S::load(from + u * lanes);
+		}
+		for (size_t u = 0; u < simd_partition_unroll; ++u) {
+			partition_vector_avx512(a, lw, rw, x[u], p, or_equal);
+		}
+	}
+
+	// the rest is saved first, everything between lw and rw is free then
+	T rest[simd_partition_unroll * 16];
+	const auto k = rr - lr;
+	std::copy(a + lr, a + rr, rest);
+	for (size_t i = 0; i < k; ++i) {
+		const auto left = or_equal ? !(pivot < rest[i]) : rest[i] < pivot;
+		if (left) {
+			a[lw++] = rest[i];
+		}
+		else {
+			a[--rw] = rest[i];
+		}
+	}
+	for (size_t u = 0; u < simd_partition_unroll; ++u) {
+		partition_vector_avx512(a, lw, rw, first[u], p, or_equal);
+		partition_vector_avx512(a, lw, rw, last[u], p, or_equal);
+	}
+	return lw;
+}
+
+/// avx512 partitions, avx2 small sorts
+template<typename T>
+struct avx512_sort_kernel {
+	static size_t partition(T * a, size_t n, T pivot, bool or_equal) {
+		return simd_partition_avx512(a, n, pivot, or_equal);
+	}
+
+	static void small_sort(T * a, size_t n) {
+		bitonic_sort_avx2(a, n);
+	}
+};
+
+#endif
+
+/// simd_quick_sort of v with at most depth more levels of recursion
+template<typename T, typename Kernel>
+void simd_quick_sort(vector_view<T> v, size_t depth, Kernel kernel) {
+	ALGO_SORT_DEPTH();
+	const auto lt = less();
+	while (v.size() > simd_sort_base) {
+		if (depth == 0) {
+			heap_sort(v);
+			return;
+		}
+		--depth;
+
+		const auto n = v.size();
+		const auto s = n / 8;
+		const auto pivot = v[median_of_three(v,
+			median_of_three(v, 0, s, 2 * s, lt),
+			median_of_three(v, n / 2 - s, n / 2, n / 2 + s, lt),
+			median_of_three(v, n - 1 - 2 * s, n - 1 - s, n - 1, lt), lt)];
+		const auto m = kernel.partition(v.data(), n, pivot, false);
+		if (m == 0) {
+			// the pivot is the smallest key, the keys equal to it are done
+			v = v.view(kernel.partition(v.data(), n, pivot, true));
+			continue;
+		}
+
+		if (m < n - m) {
+			simd_quick_sort(v.view(0, m), depth, kernel);
+			v = v.view(m);
+		}
+		else {
+			simd_quick_sort(v.view(m), depth, kernel);
+			v = v.view(0, m);
+		}
+	}
+	kernel.small_sort(v.data(), v.size());
+}
+
+/// quick sort of v with the partition and small sort of kernel, which is
+/// scalar_sort_kernel, avx2_sort_kernel or avx512_sort_kernel
+template<typename T, typename Kernel>
+void simd_quick_sort(vector_view<T> v, Kernel kernel) {
+	static_assert(is_simd_sort_key<T>::value, "simd_quick_sort takes 32 bit integers, signed 64 bit integers, floats and doubles");
+	simd_quick_sort(v, intro_sort_depth(v.size()), kernel);
+}
+
+/// quick sort of numbers with vectorized partitions and bitonic networks for small ranges:
+/// avx512 partitions if the cpu has them, avx2 if it has those and scalar ones else.
+/// the pivot is the ninther, heap_sort takes over if the recursion gets too deep.
+/// floats must not be NaN.
+template<typename T>
+void simd_quick_sort(vector_view<T> v) {
+#ifdef __x86_64__
+	if (has_avx512()) {
+		simd_quick_sort(v, avx512_sort_kernel<T>());
+		return;
+	}
+	if (has_avx2()) {
+		simd_quick_sort(v, avx2_sort_kernel<T>());
+		return;
+	}
+#endif
+	simd_quick_sort(v, scalar_sort_kernel<T>());
+}
+
+template<typename T>
+void simd_quick_sort(vector<T>& v) {
+	simd_quick_sort(v.view());
+}
+
+}
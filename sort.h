@@ -1,30 +1,91 @@
 #pragma once
 
+#include <type_traits>
+
 #include "common.h"
 #include "vector.h"
 #include "vector_view.h"
+#include "sort_stats.h"
 #include "heap.h"
 
 
 namespace algo {
 
-template<typename T>
-bool check_sorted(const vector<T>& v) {
+/// a < b, the default comparator of the sorts
+struct less {
+	template<typename A, typename B>
+	bool operator()(const A& a, const B& b) const {
+		return a < b;
+	}
+};
+
+/// x itself, the default projection of the sorts
+struct identity {
+	template<typename X>
+	const X& operator()(const X& x) const {
+		return x;
+	}
+};
+
+/// how the sorts compare elements: cmp(proj(a), proj(b))
+template<typename Cmp, typename Proj>
+struct projected_less {
+	template<typename A, typename B>
+	bool operator()(const A& a, const B& b) const {
+		return cmp(proj(a), proj(b));
+	}
+
+	Cmp cmp;
+	Proj proj;
+};
+
+template<typename Cmp, typename Proj>
+projected_less<Cmp, Proj> make_projected_less(Cmp cmp, Proj proj) {
+	return projected_less<Cmp, Proj>{cmp, proj};
+}
+
+/// true if PS picks a pivot from a vector_view<T>, which tells the
+/// pivot strategy of the quick sorts apart from a comparator
+template<typename PS, typename T, typename Enable = void>
+struct is_pivot_strategy : std::false_type {};
+
+template<typename PS, typename T>
+struct is_pivot_strategy<PS, T, decltype(void(std::declval<PS&>()(std::declval<vector_view<T>>())))> : std::true_type {};
+
+template<typename T, typename Cmp, typename Proj = identity>
+bool check_sorted(vector_view<const T> v, Cmp cmp, Proj proj = Proj()) {
+	const auto lt = make_projected_less(cmp, proj);
 	for (size_t i = 1; i < v.size(); ++i) {
-		if (v[i] < v[i - 1]) {
+		if (lt(v[i], v[i - 1])) {
 			return false;
 		}
 	}
 	return true;
 }
 
+template<typename T, typename Cmp, typename Proj = identity>
+bool check_sorted(const vector<T>& v, Cmp cmp, Proj proj = Proj()) {
+	return check_sorted(v.view(), cmp, proj);
+}
+
 template<typename T>
-void selection_sort(vector<T>& v) {
+bool check_sorted(vector_view<const T> v) {
+	return check_sorted(v, less(), identity());
+}
+
+template<typename T>
+bool check_sorted(const vector<T>& v) {
+	return check_sorted(v.view());
+}
+
+template<typename T, typename Cmp, typename Proj = identity>
+void selection_sort(vector_view<T> v, Cmp cmp, Proj proj = Proj()) {
+	const auto lt = make_projected_less(cmp, proj);
 	const auto size = v.size();
 	for (size_t i = 0; i < size; ++i) {
 		auto min_pos = i;
 		for (size_t j = i + 1; j < size; ++j) {
-			if (v[j] < v[min_pos]) {
+			if (lt(v[j], v[min_pos])) {
 				min_pos = j;
 			}
 		}
@@ -34,36 +95,83 @@ void selection_sort(vector<T>& v) {
 	}
 }
 
+template<typename T, typename Cmp, typename Proj = identity>
+void selection_sort(vector<T>& v, Cmp cmp, Proj proj = Proj()) {
+	selection_sort(v.view(), cmp, proj);
+}
+
 template<typename T>
-void insertion_sort(vector<T>& v) {
+void selection_sort(vector_view<T> v) {
+	selection_sort(v, less(), identity());
+}
+
+template<typename T>
+void selection_sort(vector<T>& v) {
+	selection_sort(v.view());
+}
+
+template<typename T, typename Cmp, typename Proj = identity>
+void insertion_sort(vector_view<T> v, Cmp cmp, Proj proj = Proj()) {
+	const auto lt = make_projected_less(cmp, proj);
 	const auto size = v.size();
 	for (size_t i = 1; i < size; ++i) {
+		// elements already in place are not touched
+		if (!lt(v[i], v[i - 1])) {
+			continue;
+		}
 		auto cur = std::move(v[i]);
-		auto to_pos = static_cast<int>(i) - 1;
-		while (to_pos >= 0 && v[to_pos] > cur) {
-			v[to_pos + 1] = std::move(v[to_pos]);
+		auto to_pos = i;
+		do {
+			v[to_pos] = std::move(v[to_pos - 1]);
 			--to_pos;
-		}
-
-		++to_pos;
-		if (i != to_pos) {
-			v[to_pos] = std::move(cur);
-		}
+		} while (to_pos > 0 && lt(cur, v[to_pos - 1]));
+		v[to_pos] = std::move(cur);
 	}
 }
 
+template<typename T, typename Cmp, typename Proj = identity>
+void insertion_sort(vector<T>& v, Cmp cmp, Proj proj = Proj()) {
+	insertion_sort(v.view(), cmp, proj);
+}
+
 template<typename T>
-void bubble_sort(vector<T>& v) {
+void insertion_sort(vector_view<T> v) {
+	insertion_sort(v, less(), identity());
+}
+
+template<typename T>
+void insertion_sort(vector<T>& v) {
+	insertion_sort(v.view());
+}
+
+template<typename T, typename Cmp, typename Proj = identity>
+void bubble_sort(vector_view<T> v, Cmp cmp, Proj proj = Proj()) {
+	const auto lt = make_projected_less(cmp, proj);
 	const auto size = v.size();
 	for (size_t i = 0; i < size; ++i) {
 		for (size_t j = 0; j < size - i - 1; ++j) {
-			if (v[j] > v[j + 1]) {
+			if (lt(v[j + 1], v[j])) {
 				std::swap(v[j], v[j + 1]);
 			}
 		}
 	}
 }
 
+template<typename T, typename Cmp, typename Proj = identity>
+void bubble_sort(vector<T>& v, Cmp cmp, Proj proj = Proj()) {
+	bubble_sort(v.view(), cmp, proj);
+}
+
+template<typename T>
+void bubble_sort(vector_view<T> v) {
+	bubble_sort(v, less(), identity());
+}
+
+template<typename T>
+void bubble_sort(vector<T>& v) {
+	bubble_sort(v.view());
+}
+
 template<typename T>
 void merge(vector_view<T> l, vector_view<T> r) {
 	const auto size = l.size() + r.size();
@@ -86,18 +194,76 @@ void merge(vector_view<T> l, vector_view<T> r) {
 	}
 }
 
+/// stable merge of l and r into out, which has room for both, in the order of lt
+template<typename T, typename Less>
+void merge(const_view_t<T> l, const_view_t<T> r, vector_view<T> out, const Less& lt) {
+	assert(out.size() == l.size() + r.size());
+	const auto * a = l.data();
+	const auto * a_end = a + l.size();
+	const auto * b = r.data();
+	const auto * b_end = b + r.size();
+	auto * o = out.data();
+	while (a != a_end && b != b_end) {
+		// equal elements come from l first
+		const bool take_b = lt(*b, *a);
+		*o = take_b ? *b : *a;
+		++o;
+		b += take_b;
+		a += !take_b;
+	}
+	o = std::copy(a, a_end, o);
+	std::copy(b, b_end, o);
+}
+
+/// stable merge of l and r into out, which has room for both
 template<typename T>
-void merge_sort(vector_view<T> v) {
-	if (v.size() <= 1) {
+void merge(const_view_t<T> l, const_view_t<T> r, vector_view<T> out) {
+	merge<T>(l, r, out, less());
+}
+
+/// merge_sort that merges through buf, which is as large as v, instead of allocating
+template<typename T, typename Cmp, typename Proj = identity>
+void merge_sort(vector_view<T> v, vector_view<T> buf, Cmp cmp, Proj proj = Proj()) {
+	ALGO_SORT_DEPTH();
+	assert(buf.size() >= v.size());
+	if (v.size() <= 16) {
+		insertion_sort(v, cmp, proj);
 		return;
 	}
 
+	const auto lt = make_projected_less(cmp, proj);
 	const auto middle = v.size() / 2;
-	auto left = v.view(0, middle);
-	auto right = v.view(middle);
-	merge_sort(left);
-	merge_sort(right);
-	merge(left, right);
+	merge_sort(v.view(0, middle), buf.view(0, middle), cmp, proj);
+	merge_sort(v.view(middle), buf.view(middle), cmp, proj);
+	if (!lt(v[middle], v[middle - 1])) {
+		return;
+	}
+	auto out = buf.view(0, v.size());
+	merge<T>(v.view(0, middle), v.view(middle), out, lt);
+	std::copy(out.begin(), out.end(), v.begin());
+}
+
+template<typename T>
+void merge_sort(vector_view<T> v, vector_view<T> buf) {
+	merge_sort(v, buf, less(), identity());
+}
+
+/// stable, needs a buffer as large as v
+template<typename T, typename Cmp, typename Proj = identity>
+void merge_sort(vector_view<T> v, Cmp cmp, Proj proj = Proj()) {
+	ALGO_SORT_ALLOCATION(v.size() * sizeof(T));
+	vector<T> buf(v.size(), T{});
+	merge_sort(v, buf.view(), cmp, proj);
+}
+
+template<typename T, typename Cmp, typename Proj = identity>
+void merge_sort(vector<T>& v, Cmp cmp, Proj proj = Proj()) {
+	merge_sort(v.view(), cmp, proj);
+}
+
+template<typename T>
+void merge_sort(vector_view<T> v) {
+	merge_sort(v, less(), identity());
 }
 
 template<typename T>
@@ -115,22 +281,22 @@ T random_pivot_strategy(vector_view<T> v) {
 	return v[rand() % v.size()];
 }
 
-template<typename T, typename PS>
-void copy_quick_sort(vector_view<T> v, PS&& ps) {
+template<typename T, typename PS, typename Cmp, typename Proj = identity, typename std::enable_if<is_pivot_strategy<PS, T>::value, int>::type = 0>
+void copy_quick_sort(vector_view<T> v, PS&& ps, Cmp cmp, Proj proj = Proj()) {
+	ALGO_SORT_DEPTH();
 	if (v.size() <= 1) {
 		return;
 	}
 
+	const auto lt = make_projected_less(cmp, proj);
 	const auto pivot = ps(v);
-	int i = 0;
-	int j = static_cast<int>(v.size()) - 1;
 	vector<T> left, right;
 	size_t eq_cnt = 0;
 	for (size_t i = 0; i < v.size(); ++i) {
-		if (v[i] < pivot) {
+		if (lt(v[i], pivot)) {
 			left.push_back(v[i]);
 		}
-		else if (v[i] > pivot) {
+		else if (lt(pivot, v[i])) {
 			right.push_back(v[i]);
 		}
 		else {
@@ -139,10 +305,10 @@ void copy_quick_sort(vector_view<T> v, PS&& ps) {
 	}
 
 	if (left.size() != 0) {
-		copy_quick_sort(left, ps);
+		copy_quick_sort(left.view(), ps, cmp, proj);
 	}
 	if (right.size() != 0) {
-		copy_quick_sort(right, ps);
+		copy_quick_sort(right.view(), ps, cmp, proj);
 	}
 
 	for (size_t i = 0; i < left.size(); ++i) {
@@ -156,30 +322,57 @@ void copy_quick_sort(vector_view<T> v, PS&& ps) {
 	}
 }
 
-template<typename T, typename PS>
+template<typename T, typename PS, typename Cmp, typename Proj = identity, typename std::enable_if<is_pivot_strategy<PS, T>::value, int>::type = 0>
+void copy_quick_sort(vector<T>& v, PS&& ps, Cmp cmp, Proj proj = Proj()) {
+	copy_quick_sort(v.view(), std::forward<PS>(ps), cmp, proj);
+}
+
+template<typename T, typename PS, typename std::enable_if<is_pivot_strategy<PS, T>::value, int>::type = 0>
+void copy_quick_sort(vector_view<T> v, PS&& ps) {
+	copy_quick_sort(v, std::forward<PS>(ps), less(), identity());
+}
+
+template<typename T, typename PS, typename std::enable_if<is_pivot_strategy<PS, T>::value, int>::type = 0>
 void copy_quick_sort(vector<T>& v, PS&& ps) {
 	copy_quick_sort(v.view(), std::forward<PS>(ps));
 }
 
+template<typename T, typename Cmp, typename Proj = identity, typename std::enable_if<!is_pivot_strategy<Cmp, T>::value, int>::type = 0>
+void copy_quick_sort(vector_view<T> v, Cmp cmp, Proj proj = Proj()) {
+	copy_quick_sort(v, random_pivot_strategy<T>, cmp, proj);
+}
+
+template<typename T, typename Cmp, typename Proj = identity, typename std::enable_if<!is_pivot_strategy<Cmp, T>::value, int>::type = 0>
+void copy_quick_sort(vector<T>& v, Cmp cmp, Proj proj = Proj()) {
+	copy_quick_sort(v.view(), cmp, proj);
+}
+
+template<typename T>
+void copy_quick_sort(vector_view<T> v) {
+	copy_quick_sort(v, random_pivot_strategy<T>);
+}
+
 template<typename T>
 void copy_quick_sort(vector<T>& v) {
 	copy_quick_sort(v, random_pivot_strategy<T>);
 }
 
-template<typename T, typename PS>
-void quick_sort(vector_view<T> v, PS&& ps) {
+template<typename T, typename PS, typename Cmp, typename Proj = identity, typename std::enable_if<is_pivot_strategy<PS, T>::value, int>::type = 0>
+void quick_sort(vector_view<T> v, PS&& ps, Cmp cmp, Proj proj = Proj()) {
+	ALGO_SORT_DEPTH();
 	if (v.size() <= 1) {
 		return;
 	}
 
+	const auto lt = make_projected_less(cmp, proj);
 	const auto pivot = ps(v);
 	int i = 0;
 	int j = static_cast<int>(v.size()) - 1;
 	while (i <= j) {
-		while (v[i] < pivot) {
+		while (lt(v[i], pivot)) {
 			++i;
 		}
-		while (v[j] > pivot) {
+		while (lt(pivot, v[j])) {
 			--j;
 		}
 		if (i < j) {
@@ -192,211 +385,421 @@ void quick_sort(vector_view<T> v, PS&& ps) {
 	}
 
 	if (i < v.size()) {
-		quick_sort(v.view(i), ps);
+		quick_sort(v.view(i), ps, cmp, proj);
 	}
 
 	if (j != 0) {
-		quick_sort(v.view(0, j + 1), ps);
+		quick_sort(v.view(0, j + 1), ps, cmp, proj);
 	}
 }
 
-template<typename T, typename PS>
+template<typename T, typename PS, typename Cmp, typename Proj = identity, typename std::enable_if<is_pivot_strategy<PS, T>::value, int>::type = 0>
+void quick_sort(vector<T>& v, PS&& ps, Cmp cmp, Proj proj = Proj()) {
+	quick_sort(v.view(), std::forward<PS>(ps), cmp, proj);
+}
+
+template<typename T, typename PS, typename std::enable_if<is_pivot_strategy<PS, T>::value, int>::type = 0>
+void quick_sort(vector_view<T> v, PS&& ps) {
+	quick_sort(v, std::forward<PS>(ps), less(), identity());
+}
+
+template<typename T, typename PS, typename std::enable_if<is_pivot_strategy<PS, T>::value, int>::type = 0>
 void quick_sort(vector<T>& v, PS&& ps) {
 	quick_sort(v.view(), std::forward<PS>(ps));
 }
 
-template<typename T>
-void quick_sort(vector<T>& v) {
-	quick_sort(v, random_pivot_strategy<T>);
+template<typename T, typename Cmp, typename Proj = identity, typename std::enable_if<!is_pivot_strategy<Cmp, T>::value, int>::type = 0>
+void quick_sort(vector_view<T> v, Cmp cmp, Proj proj = Proj()) {
+	quick_sort(v, random_pivot_strategy<T>, cmp, proj);
+}
+
+template<typename T, typename Cmp, typename Proj = identity, typename std::enable_if<!is_pivot_strategy<Cmp, T>::value, int>::type = 0>
+void quick_sort(vector<T>& v, Cmp cmp, Proj proj = Proj()) {
+	quick_sort(v.view(), cmp, proj);
 }
 
 template<typename T>
-void heap_sort(vector<T>& v) {
-	heap<T> h(v);
-	for (int i = h.size() - 1; i >= 0; --i) {
-		v[i] = h.pop_max();
-	}
+void quick_sort(vector_view<T> v) {
+	quick_sort(v, random_pivot_strategy<T>);
 }
 
-/// T can only be an integer type
 template<typename T>
-void counting_sort(vector_view<T> v, T min, T max) {
-	size_t counts[max - min + 1];
-	for (size_t i = 0; i < max - min; ++i) {
-		counts[i] = 0;
-	}
+void quick_sort(vector<T>& v) {
+	quick_sort(v, random_pivot_strategy<T>);
+}
 
-	for (size_t i = 0; i < v.size(); ++i) {
-		++counts[v[i] - min];
+/// moves v[i] down the max heap in v[0, n) until both children are not larger
+template<typename T, typename Less>
+void sift_down(vector_view<T> v, size_t i, size_t n, const Less& lt) {
+	while (true) {
+		auto child = 2 * i + 1;
+		if (child >= n) {
+			return;
+		}
+		if (child + 1 < n && lt(v[child], v[child + 1])) {
+			++child;
+		}
+		if (!lt(v[i], v[child])) {
+			return;
+		}
+		std::swap(v[i], v[child]);
+		i = child;
 	}
+}
 
-	size_t total = 0;
-	for (size_t i = 0; i <= max - min; ++i) {
-		auto cnt = counts[i];
-		counts[i] = total;
-		total += cnt;
+/// in place: v becomes a max heap, then its maximum is swapped to the end n times
+template<typename T, typename Cmp, typename Proj = identity>
+void heap_sort(vector_view<T> v, Cmp cmp, Proj proj = Proj()) {
+	const auto lt = make_projected_less(cmp, proj);
+	const auto n = v.size();
+	for (auto i = n / 2; i > 0; --i) {
+		sift_down(v, i - 1, n, lt);
 	}
-
-	vector<T> out(v.size(), 0);
-	for (size_t i = 0; i < v.size(); ++i) {
-		auto key = v[i] - min;
-		out[counts[key]] = v[i];
-		++counts[key];
+	for (auto end = n; end > 1; --end) {
+		std::swap(v[0], v[end - 1]);
+		sift_down(v, 0, end - 1, lt);
 	}
+}
 
-	for (size_t i = 0; i < out.size(); ++i) {
-		v[i] = out[i];
-	}
+template<typename T, typename Cmp, typename Proj = identity>
+void heap_sort(vector<T>& v, Cmp cmp, Proj proj = Proj()) {
+	heap_sort(v.view(), cmp, proj);
 }
 
-/// T can only be an integer type
 template<typename T>
-void counting_sort(vector<T>& v, T min, T max) {
-	return counting_sort(v.view(), min, max);
+void heap_sort(vector_view<T> v) {
+	heap_sort(v, less(), identity());
 }
 
-/// T can only be an integer type
 template<typename T>
-void counting_sort(vector_view<T> v) {
-	auto min = v[0];
-	auto max = v[0];
-	for (size_t i = 1; i < v.size(); ++i) {
-		if (v[i] > max) {
-			max = v[i];
+void heap_sort(vector<T>& v) {
+	heap_sort(v.view());
+}
+
+/// ranges up to this size are insertion sorted by intro_sort
+const size_t intro_sort_base = 16;
+
+/// the index of the median of v[a], v[b] and v[c]
+template<typename T, typename Less>
+size_t median_of_three(vector_view<T> v, size_t a, size_t b, size_t c, const Less& lt) {
+	if (lt(v[b], v[a])) {
+		std::swap(a, b);
+	}
+	if (lt(v[c], v[b])) {
+		b = lt(v[c], v[a]) ? a : c;
+	}
+	return b;
+}
+
+/// 2 log2 n, the recursion depth after which intro_sort gives up on quick sort
+inline size_t intro_sort_depth(size_t n) {
+	size_t res = 0;
+	for (; n > 1; n /= 2) {
+		res += 2;
+	}
+	return res;
+}
+
+/// intro_sort of v with at most depth more levels of recursion
+template<typename T, typename Cmp, typename Proj>
+void intro_sort(vector_view<T> v, size_t depth, Cmp cmp, Proj proj) {
+	ALGO_SORT_DEPTH();
+	const auto lt = make_projected_less(cmp, proj);
+	while (v.size() > intro_sort_base) {
+		if (depth == 0) {
+			heap_sort(v, cmp, proj);
+			return;
 		}
-		else if (v[i] < min) {
-			min = v[i];
+		--depth;
+
+		// median of three to the front, it is the pivot and stops the scan from the right
+		const auto n = v.size();
+		std::swap(v[0], v[median_of_three(v, 1, n / 2, n - 1, lt)]);
+
+		// hoare partition around v[0], equal elements stop both scans so they are spread evenly
+		size_t i = 0;
+		size_t j = n;
+		while (true) {
+			while (lt(v[++i], v[0]) && i < n - 1) {}
+			while (lt(v[0], v[--j])) {}
+			if (i >= j) {
+				break;
+			}
+			std::swap(v[i], v[j]);
+		}
+		std::swap(v[0], v[j]);
+
+		// recursion on the smaller side keeps the stack at log n
+		if (j < n - j - 1) {
+			intro_sort(v.view(0, j), depth, cmp, proj);
+			v = v.view(j + 1);
+		}
+		else {
+			intro_sort(v.view(j + 1), depth, cmp, proj);
+			v = v.view(0, j);
 		}
 	}
-	return counting_sort(v, min, max);
+	insertion_sort(v, cmp, proj);
+}
+
+/// quick sort with median of three pivots that switches to heap_sort when the
+/// recursion gets deeper than 2 log2 n, so it takes O(n log n) on any input (Musser)
+template<typename T, typename Cmp, typename Proj = identity>
+void intro_sort(vector_view<T> v, Cmp cmp, Proj proj = Proj()) {
+	intro_sort(v, intro_sort_depth(v.size()), cmp, proj);
+}
+
+template<typename T, typename Cmp, typename Proj = identity>
+void intro_sort(vector<T>& v, Cmp cmp, Proj proj = Proj()) {
+	intro_sort(v.view(), cmp, proj);
+}
+
+template<typename T>
+void intro_sort(vector_view<T> v) {
+	intro_sort(v, less(), identity());
 }
 
-/// T can only be an integer type
 template<typename T>
-void counting_sort(vector<T>& v) {
-	return counting_sort(v.view());
-}
-
-/// T can only be an integer type
-template<typename T, size_t Base = 10>
-void lsd_radix_sort(vector<T>& v, T max) {
-	for (size_t num = 1; num <= max; num *= Base) {
-		vector<T> buckets[Base];
-		for (size_t i = 0; i < v.size(); ++i) {
-			const auto& val = v[i];
-			buckets[(val / num) % Base].push_back(val);
+void intro_sort(vector<T>& v) {
+	intro_sort(v.view());
+}
+
+/// three_way_quick_sort of v with at most depth more levels of recursion
+template<typename T, typename Cmp, typename Proj>
+void three_way_quick_sort(vector_view<T> v, size_t depth, Cmp cmp, Proj proj) {
+	ALGO_SORT_DEPTH();
+	const auto lt = make_projected_less(cmp, proj);
+	while (v.size() > intro_sort_base) {
+		if (depth == 0) {
+			heap_sort(v, cmp, proj);
+			return;
 		}
+		--depth;
 
-		size_t cnt = 0;
-		for (size_t i = 0; i < Base; ++i) {
-			const auto& bucket = buckets[i];
-			for (size_t k = 0; k < bucket.size(); ++k) {
-				v[cnt] = bucket[k];
-				++cnt;
+		// median of three, of three medians of three for large ranges (Tukey's ninther)
+		const auto n = v.size();
+		size_t m = 0;
+		if (n < 64) {
+			m = median_of_three(v, 0, n / 2, n - 1, lt);
+		}
+		else {
+			const auto s = n / 8;
+			m = median_of_three(v,
+				median_of_three(v, 0, s, 2 * s, lt),
+				median_of_three(v, n / 2 - s, n / 2, n / 2 + s, lt),
+				median_of_three(v, n - 1 - 2 * s, n - 1 - s, n - 1, lt), lt);
+		}
+		std::swap(v[0], v[m]);
+
+		// v[0, a) == pivot, v[a, b) < pivot, v(c, d] > pivot, v(d, n) == pivot
+		size_t a = 1;
+		size_t b = 1;
+		auto c = n - 1;
+		auto d = n - 1;
+		while (true) {
+			while (b <= c && !lt(v[0], v[b])) {
+				if (!lt(v[b], v[0])) {
+					std::swap(v[a], v[b]);
+					++a;
+				}
+				++b;
+			}
+			while (b <= c && !lt(v[c], v[0])) {
+				if (!lt(v[0], v[c])) {
+					std::swap(v[c], v[d]);
+					--d;
+				}
+				--c;
 			}
+			if (b > c) {
+				break;
+			}
+			std::swap(v[b], v[c]);
+			++b;
+			--c;
 		}
-	}
-}
 
-/// T can only be an integer type
-template<typename T, size_t Base = 10>
-void lsd_radix_sort(vector<T>& v) {
-	auto max = v[0];
-	for (size_t i = 1; i < v.size(); ++i) {
-		if (v[i] > max) {
-			max = v[i];
+		// the equal elements from both ends to the middle
+		const auto less_cnt = b - a;
+		const auto greater_cnt = d - c;
+		const auto l = std::min(a, less_cnt);
+		std::swap_ranges(v.begin(), v.begin() + l, v.begin() + (b - l));
+		const auto r = std::min(greater_cnt, n - 1 - d);
+		std::swap_ranges(v.begin() + b, v.begin() + (b + r), v.begin() + (n - r));
+
+		// the equal elements are done, recursion on the smaller side
+		if (less_cnt < greater_cnt) {
+			three_way_quick_sort(v.view(0, less_cnt), depth, cmp, proj);
+			v = v.view(n - greater_cnt);
+		}
+		else {
+			three_way_quick_sort(v.view(n - greater_cnt), depth, cmp, proj);
+			v = v.view(0, less_cnt);
 		}
 	}
-	return lsd_radix_sort<T, Base>(v, max);
+	insertion_sort(v, cmp, proj);
+}
+
+/// quick sort with a 3-way partition (Bentley, McIlroy): elements equal to the pivot
+/// are swapped to the ends while partitioning, then to the middle, and are never
+/// looked at again. n log k comparisons for k distinct keys, so it suits inputs with
+/// few distinct keys. like intro_sort it falls back to heap_sort if the recursion gets too deep.
+template<typename T, typename Cmp, typename Proj = identity>
+void three_way_quick_sort(vector_view<T> v, Cmp cmp, Proj proj = Proj()) {
+	three_way_quick_sort(v, intro_sort_depth(v.size()), cmp, proj);
+}
+
+template<typename T, typename Cmp, typename Proj = identity>
+void three_way_quick_sort(vector<T>& v, Cmp cmp, Proj proj = Proj()) {
+	three_way_quick_sort(v.view(), cmp, proj);
 }
 
-/// T can only be an integer type
 template<typename T>
-void msd_radix_sort_bin(vector_view<T> v, int maxd, T max) {
-	const auto Base = 2;
-	if (v.size() < 2 || maxd < 0) {
-		return;
-	}
+void three_way_quick_sort(vector_view<T> v) {
+	three_way_quick_sort(v, less(), identity());
+}
 
-	int i = 0;
-	int j = static_cast<int>(v.size()) - 1;
-	while (i <= j) {
-		while (i < v.size() && (v[i] / max) % Base == 0) {
-			++i;
-		}
-		while (j >= 0 && (v[j] / max) % Base == 1) {
-			--j;
+template<typename T>
+void three_way_quick_sort(vector<T>& v) {
+	three_way_quick_sort(v.view());
+}
+
+/// runs shorter than this are extended by insertion sort in natural_merge_sort
+const size_t natural_merge_min_run = 32;
+
+/// stable merge sort that starts from the runs already in v, like Timsort: strictly
+/// descending runs are reversed, short runs are extended to natural_merge_min_run
+/// elements, then neighboring runs are merged pairwise through a buffer as large as v.
+/// O(n log r) for r runs, O(n) on sorted or reversed input.
+template<typename T, typename Cmp, typename Proj = identity>
+void natural_merge_sort(vector_view<T> v, Cmp cmp, Proj proj = Proj()) {
+	const auto lt = make_projected_less(cmp, proj);
+	const auto n = v.size();
+	vector<size_t> bounds(1, 0);
+	size_t from = 0;
+	while (from < n) {
+		auto to = from + 1;
+		if (to < n && lt(v[to], v[from])) {
+			while (to < n && lt(v[to], v[to - 1])) {
+				++to;
+			}
+			std::reverse(v.begin() + from, v.begin() + to);
 		}
-		if (i < j) {
-			std::swap(v[i], v[j]);
+		else {
+			while (to < n && !lt(v[to], v[to - 1])) {
+				++to;
+			}
 		}
-		if (i <= j) {
-			++i;
-			--j;
+		if (to - from < natural_merge_min_run && to < n) {
+			to = std::min(from + natural_merge_min_run, n);
+			insertion_sort(v.view(from, to), cmp, proj);
 		}
+		bounds.push_back(to);
+		from = to;
 	}
-
-	if (i < v.size()) {
-		msd_radix_sort_bin<T>(v.view(i), maxd - 1, max / Base);
+	if (bounds.size() <= 2) {
+		return;
 	}
 
-	if (j != 0) {
-		msd_radix_sort_bin<T>(v.view(0, j + 1), maxd - 1, max / Base);
+	ALGO_SORT_ALLOCATION(n * sizeof(T));
+	vector<T> buf(n, T{});
+	while (bounds.size() > 2) {
+		vector<size_t> merged(1, 0);
+		for (size_t i = 0; i + 1 < bounds.size(); i += 2) {
+			if (i + 2 == bounds.size()) {
+				// an odd run out waits for the next pass
+				merged.push_back(bounds[i + 1]);
+				break;
+			}
+			const auto l = bounds[i];
+			const auto m = bounds[i + 1];
+			const auto r = bounds[i + 2];
+			if (lt(v[m], v[m - 1])) {
+				auto out = buf.view(l, r);
+				merge<T>(v.view(l, m), v.view(m, r), out, lt);
+				std::move(out.begin(), out.end(), v.begin() + l);
+			}
+			merged.push_back(r);
+		}
+		bounds = std::move(merged);
 	}
 }
 
-/// T can only be an integer type
+template<typename T, typename Cmp, typename Proj = identity>
+void natural_merge_sort(vector<T>& v, Cmp cmp, Proj proj = Proj()) {
+	natural_merge_sort(v.view(), cmp, proj);
+}
+
 template<typename T>
-void msd_radix_sort_bin(vector<T>& v, int maxd, T max) {
-	return msd_radix_sort_bin<T>(v.view(), maxd, max);
+void natural_merge_sort(vector_view<T> v) {
+	natural_merge_sort(v, less(), identity());
 }
 
-/// T can only be an integer type
-template<typename T, size_t Base = 10>
-void msd_radix_sort(vector<T>& v, int maxd, T max) {
-	if (v.size() < 2 || maxd < 0) {
-		return;
-	}
+template<typename T>
+void natural_merge_sort(vector<T>& v) {
+	natural_merge_sort(v.view());
+}
 
-	vector<T> buckets[Base];
+/// stable counting sort of v by the integer keys proj(x), which lie in [min, max].
+/// O(n + max - min) time and memory
+template<typename T, typename K, typename Proj = identity>
+void counting_sort(vector_view<T> v, K min, K max, Proj proj = Proj()) {
+	static_assert(std::is_integral<K>::value && !std::is_same<K, bool>::value, "counting_sort takes integer keys");
+	using U = typename std::make_unsigned<K>::type;
+	// modulo 2^bits of K, so signed keys of any range have their offset without
+	// overflow. keys narrower than int are promoted, the difference is cut back to U
+	const auto offset = [min](K key) {
+		return static_cast<size_t>(static_cast<U>(static_cast<U>(key) - static_cast<U>(min)));
+	};
+	const auto range = offset(max) + 1;
+	ALGO_SORT_ALLOCATION(range * sizeof(size_t) + v.size() * sizeof(T));
+	vector<size_t> counts(range, 0);
 	for (size_t i = 0; i < v.size(); ++i) {
-		const auto& val = v[i];
-		const auto digit = (val / max) % Base;
-		buckets[digit].push_back(val);
-	}
-
-	size_t cnt = 0;
-	for (size_t i = 0; i < Base; ++i) {
-		auto& bucket = buckets[i];
-		msd_radix_sort<T, Base>(bucket, maxd - 1, max / Base);
-		for (size_t j = 0; j < bucket.size(); ++j) {
-			v[cnt] = bucket[j];
-			++cnt;
-		}
+		++counts[offset(proj(v[i]))];
 	}
-}
 
-/// T can only be an integer type
-template<typename T, size_t Base = 10>
-void msd_radix_sort(vector<T>& v) {
-	auto max = v[0];
-	for (size_t i = 1; i < v.size(); ++i) {
-		if (v[i] > max) {
-			max = v[i];
-		}
+	size_t total = 0;
+	for (size_t i = 0; i < range; ++i) {
+		const auto cnt = counts[i];
+		counts[i] = total;
+		total += cnt;
 	}
-	T num = 1;
-	int cnt = 0;
-	while (num <= max) {
-		num *= Base;
-		++cnt;
+
+	vector<T> out(v.size(), T{});
+	for (size_t i = 0; i < v.size(); ++i) {
+		auto& pos = counts[offset(proj(v[i]))];
+		out[pos] = v[i];
+		++pos;
 	}
-	if (Base == 2) {
-		msd_radix_sort_bin<T>(v, cnt - 1, static_cast<T>(num / Base));
+	for (size_t i = 0; i < out.size(); ++i) {
+		v[i] = std::move(out[i]);
 	}
-	else {
-		msd_radix_sort<T, Base>(v, cnt - 1, static_cast<T>(num / Base));
+}
+
+template<typename T, typename K, typename Proj = identity>
+void counting_sort(vector<T>& v, K min, K max, Proj proj = Proj()) {
+	counting_sort(v.view(), min, max, proj);
+}
+
+/// counting_sort between the smallest and the largest key
+template<typename T, typename Proj = identity>
+void counting_sort(vector_view<T> v, Proj proj = Proj()) {
+	if (v.size() < 2) {
+		return;
+	}
+	auto min = proj(v[0]);
+	auto max = min;
+	for (size_t i = 1; i < v.size(); ++i) {
+		const auto key = proj(v[i]);
+		min = key < min ? key : min;
+		max = max < key ? key : max;
 	}
+	counting_sort(v, min, max, proj);
+}
+
+template<typename T, typename Proj = identity>
+void counting_sort(vector<T>& v, Proj proj = Proj()) {
+	counting_sort(v.view(), proj);
 }
 
 }
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "common.h"
+#include "sort_stats.h"
+
+
+namespace algo {
+
+/// cycles, instructions and branch misses of the calling thread in user space,
+/// read through perf_event_open. not available outside linux or when the kernel
+/// does not allow it, as in many containers.
+class perf_counters {
+public:
+	perf_counters() {
+#ifdef __linux__
+		const uint64_t configs[events] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES};
+		for (size_t i = 0; i < events; ++i) {
+			perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.size = sizeof(attr);
+			attr.config = configs[i];
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			fds[i] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+		}
+#endif
+	}
+
+	perf_counters(const perf_counters&) = delete;
+	perf_counters& operator=(const perf_counters&) = delete;
+
+	~perf_counters() {
+#ifdef __linux__
+		for (size_t i = 0; i < events; ++i) {
+			if (fds[i] >= 0) {
+				close(fds[i]);
+			}
+		}
+#endif
+	}
+
+	bool available() const {
+		for (size_t i = 0; i < events; ++i) {
+			if (fds[i] < 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void start() {
+#ifdef __linux__
+		for (size_t i = 0; available() && i < events; ++i) {
+			ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+			ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+
+	/// stops counting, false if the counters could not be read
+	bool stop(uint64_t& cycles, uint64_t& instructions, uint64_t& branch_misses) {
+		uint64_t values[events] = {0, 0, 0};
+#ifdef __linux__
+		for (size_t i = 0; available() && i < events; ++i) {
+			ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+		}
+		for (size_t i = 0; available() && i < events; ++i) {
+			if (read(fds[i], &values[i], sizeof(values[i])) != sizeof(values[i])) {
+				return false;
+			}
+		}
+#endif
+		cycles = values[0];
+		instructions = values[1];
+		branch_misses = values[2];
+		return available();
+	}
+
+private:
+	static const size_t events = 3;
+
+	int fds[events] = {-1, -1, -1};
+};
+
+/// collects the work of everything sorted on this thread while it lives into stats,
+/// which is reset first. probes nest, the inner one collects alone.
+/// sorts running on other threads report nothing.
+class sort_probe {
+public:
+	explicit sort_probe(sort_stats& s) : stats(s), prev(active_sort_stats()) {
+		stats = sort_stats();
+		active_sort_stats() = &stats;
+		counters.start();
+	}
+
+	sort_probe(const sort_probe&) = delete;
+	sort_probe& operator=(const sort_probe&) = delete;
+
+	~sort_probe() {
+		stats.perf = counters.stop(stats.cycles, stats.instructions, stats.branch_misses);
+		active_sort_stats() = prev;
+	}
+
+private:
+	sort_stats& stats;
+	sort_stats * prev;
+	perf_counters counters;
+};
+
+/// a comparator that counts its calls in stats
+template<typename Cmp>
+struct counting_less {
+	template<typename A, typename B>
+	bool operator()(const A& a, const B& b) const {
+		++stats->comparisons;
+		return cmp(a, b);
+	}
+
+	sort_stats * stats;
+	Cmp cmp;
+};
+
+template<typename Cmp>
+counting_less<Cmp> make_counting_less(sort_stats& stats, Cmp cmp) {
+	return counting_less<Cmp>{&stats, cmp};
+}
+
+/// a T that counts its comparisons, copies and moves in the active sort_stats
+template<typename T>
+class counted {
+public:
+	counted() = default;
+	~counted() = default;
+
+	counted(const T& v) : val(v) {}
+
+	counted(const counted& r) : val(r.val) {
+		count(&sort_stats::copies);
+	}
+
+	counted(counted&& r) : val(std::move(r.val)) {
+		count(&sort_stats::moves);
+	}
+
+	counted& operator=(const counted& r) {
+		val = r.val;
+		count(&sort_stats::copies);
+		return *this;
+	}
+
+	counted& operator=(counted&& r) {
+		val = std::move(r.val);
+		count(&sort_stats::moves);
+		return *this;
+	}
+
+	bool operator<(const counted& r) const {
+		count(&sort_stats::comparisons);
+		return val < r.val;
+	}
+
+	bool operator>(const counted& r) const {
+		count(&sort_stats::comparisons);
+		return r.val < val;
+	}
+
+	bool operator==(const counted& r) const {
+		count(&sort_stats::comparisons);
+		return val == r.val;
+	}
+
+	bool operator!=(const counted& r) const {
+		return !(*this == r);
+	}
+
+	const T& get() const {
+		return val;
+	}
+
+private:
+	static void count(size_t sort_stats::* field) {
+		auto * stats = active_sort_stats();
+		if (stats != nullptr) {
+			++(stats->*field);
+		}
+	}
+
+	T val{};
+};
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+
+#include "common.h"
+
+
+namespace algo {
+
+/// the work of the sorts called while a sort_probe is active. comparisons, copies and
+/// moves are counted by counting_less and counted elements, a swap is 3 moves.
+/// depth and allocations come from hooks in the library that are only compiled in
+/// with ALGO_SORT_STATS defined, cycles and branch misses from the hardware counters.
+struct sort_stats {
+	size_t comparisons{0};
+	size_t copies{0};
+	size_t moves{0};
+	size_t depth{0};
+	size_t max_depth{0};
+	size_t allocations{0};
+	size_t allocated_bytes{0};
+	/// whether the hardware counters below were read
+	bool perf{false};
+	uint64_t cycles{0};
+	uint64_t instructions{0};
+	uint64_t branch_misses{0};
+};
+
+/// the stats of this thread's active sort_probe, nullptr if there is none
+inline sort_stats *& active_sort_stats() {
+	static thread_local sort_stats * res = nullptr;
+	return res;
+}
+
+/// counts a level of recursion of a sort while it lives
+class sort_depth_guard {
+public:
+	sort_depth_guard() : stats(active_sort_stats()) {
+		if (stats != nullptr) {
+			++stats->depth;
+			stats->max_depth = std::max(stats->max_depth, stats->depth);
+		}
+	}
+
+	sort_depth_guard(const sort_depth_guard&) = delete;
+	sort_depth_guard& operator=(const sort_depth_guard&) = delete;
+
+	~sort_depth_guard() {
+		if (stats != nullptr) {
+			--stats->depth;
+		}
+	}
+
+private:
+	sort_stats * stats;
+};
+
+inline void count_sort_allocation(size_t bytes) {
+	auto * stats = active_sort_stats();
+	if (stats != nullptr) {
+		++stats->allocations;
+		stats->allocated_bytes += bytes;
+	}
+}
+
+}
+
+/// hooks of the library for sort_stats, nothing unless ALGO_SORT_STATS is defined
+#ifdef ALGO_SORT_STATS
+#define ALGO_SORT_DEPTH() ::algo::sort_depth_guard algo_sort_depth_guard
+#define ALGO_SORT_ALLOCATION(bytes) ::algo::count_sort_allocation(bytes)
+#else
+#define ALGO_SORT_DEPTH() static_cast<void>(0)
+#define ALGO_SORT_ALLOCATION(bytes) static_cast<void>(0)
+#endif
@@ -0,0 +1,186 @@
+#pragma once
+
+#include "common.h"
+#include "vector.h"
+#include "vector_view.h"
+#include "btree.h"
+
+
+namespace algo {
+
+/// read-only search index over sorted values stored in Eytzinger (BFS) order:
+/// the children of node k are 2k and 2k + 1, so the first levels of every
+/// search share cache lines and the next levels can be prefetched.
+template<typename T>
+class eytzinger_index {
+public:
+	using type = T;
+
+	eytzinger_index() = default;
+	eytzinger_index(const eytzinger_index&) = default;
+	eytzinger_index(eytzinger_index&&) = default;
+	~eytzinger_index() = default;
+	eytzinger_index& operator=(const eytzinger_index&) = default;
+	eytzinger_index& operator=(eytzinger_index&&) = default;
+
+	explicit eytzinger_index(vector_view<const T> sorted) : data(sorted.size() + 1, T{}) {
+		size_t pos = 0;
+		build(sorted, pos, 1);
+	}
+
+	explicit eytzinger_index(const vector<T>& sorted) : eytzinger_index(sorted.view()) {}
+
+	size_t size() const {
+		return data.size() - 1;
+	}
+
+	bool empty() const {
+		return size() == 0;
+	}
+
+	/// the smallest value not less than val or nullptr
+	const T * lower_bound(const T& val) const {
+		const auto * arr = data.data();
+		const auto n = size();
+		size_t k = 1;
+		while (k <= n) {
+			// the descendants 4 levels down are adjacent
+			__builtin_prefetch(arr + k * prefetch_stride);
+			k = 2 * k + (arr[k] < val);
+		}
+		// drop the trailing right turns and the last left one
+		k >>= __builtin_ffsll(~k);
+		return k == 0 ? nullptr : arr + k;
+	}
+
+	const T * find(const T& val) const {
+		const auto * res = lower_bound(val);
+		return res == nullptr || !(*res == val) ? nullptr : res;
+	}
+
+private:
+	static const size_t prefetch_stride = 64 / sizeof(T) > 1 ? 64 / sizeof(T) : 1;
+
+	void build(vector_view<const T> sorted, size_t& pos, size_t k) {
+		if (k > size()) {
+			return;
+		}
+		build(sorted, pos, 2 * k);
+		data[k] = sorted[pos];
+		++pos;
+		build(sorted, pos, 2 * k + 1);
+	}
+
+	vector<T> data{1, T{}};
+};
+
+template<typename T>
+const size_t eytzinger_index<T>::prefetch_stride;
+
+/// read-only search index over sorted values laid out as an implicit B-tree (S-tree):
+/// nodes of B keys fill whole cache lines, the children of node k are
+/// k * (B + 1) + i + 1 and in-node search is the vectorized btree_rank.
+template<typename T, size_t B = (64 / sizeof(T) > 2 ? 64 / sizeof(T) : 2)>
+class stree_index {
+public:
+	using type = T;
+
+	stree_index() = default;
+	stree_index(const stree_index&) = default;
+	stree_index(stree_index&&) = default;
+	~stree_index() = default;
+	stree_index& operator=(const stree_index&) = default;
+	stree_index& operator=(stree_index&&) = default;
+
+	explicit stree_index(vector_view<const T> sorted) : cnt(sorted.size()), blocks((sorted.size() + B - 1) / B) {
+		if (cnt == 0) {
+			return;
+		}
+		// the tail of the last node is padded with the maximum, so a search never leaves the tree early.
+		// the spare node lets the first one start on a cache line boundary.
+		data = vector<T>((blocks + 1) * B, sorted[cnt - 1]);
+		while (reinterpret_cast<uintptr_t>(data.data() + offset) % 64 != 0 && offset < B) {
+			++offset;
+		}
+		if (offset == B) {
+			offset = 0;
+		}
+		size_t pos = 0;
+		build(sorted, pos, 0);
+	}
+
+	explicit stree_index(const vector<T>& sorted) : stree_index(sorted.view()) {}
+
+	size_t size() const {
+		return cnt;
+	}
+
+	bool empty() const {
+		return cnt == 0;
+	}
+
+	/// the smallest value not less than val or nullptr
+	const T * lower_bound(const T& val) const {
+		const auto * arr = data.data() + offset;
+		const T * res = nullptr;
+		size_t k = 0;
+		while (k < blocks) {
+			const auto * keys = arr + k * B;
+			const auto i = btree_rank(keys, B, val);
+			res = i < B ? keys + i : res;
+			k = child(k, i);
+		}
+		return res;
+	}
+
+	const T * find(const T& val) const {
+		const auto * res = lower_bound(val);
+		return res == nullptr || !(*res == val) ? nullptr : res;
+	}
+
+private:
+	static size_t child(size_t k, size_t i) {
+		return k * (B + 1) + i + 1;
+	}
+
+	void build(vector_view<const T> sorted, size_t& pos, size_t k) {
+		if (k >= blocks) {
+			return;
+		}
+		for (size_t i = 0; i < B; ++i) {
+			build(sorted, pos, child(k, i));
+			if (pos < cnt) {
+				data[offset + k * B + i] = sorted[pos];
+				++pos;
+			}
+		}
+		build(sorted, pos, child(k, B));
+	}
+
+	size_t cnt{0};
+	size_t blocks{0};
+	size_t offset{0};
+	vector<T> data{};
+};
+
+template<typename T>
+const T * lower_bound(const eytzinger_index<T>& index, const T& val) {
+	return index.lower_bound(val);
+}
+
+template<typename T>
+const T * binary_search(const eytzinger_index<T>& index, const T& val) {
+	return index.find(val);
+}
+
+template<typename T, size_t B>
+const T * lower_bound(const stree_index<T, B>& index, const T& val) {
+	return index.lower_bound(val);
+}
+
+template<typename T, size_t B>
+const T * binary_search(const stree_index<T, B>& index, const T& val) {
+	return index.find(val);
+}
+
+}
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "common.h"
+#include "vector.h"
+#include "vector_view.h"
+#include "sort_stats.h"
+
+
+namespace algo {
+
+/// char d of s as unsigned, 0 past its end. strings compare like strcmp,
+/// so std::strings with 0 chars in them compare as if they ended there.
+inline unsigned char string_char(const char * s, size_t d) {
+	return static_cast<unsigned char>(s[d]);
+}
+
+inline unsigned char string_char(const std::string& s, size_t d) {
+	return d < s.size() ? static_cast<unsigned char>(s[d]) : 0;
+}
+
+/// the length of the common prefix of a and b, both share the first d chars
+template<typename T>
+size_t string_lcp(const T& a, const T& b, size_t d) {
+	while (string_char(a, d) == string_char(b, d) && string_char(a, d) != 0) {
+		++d;
+	}
+	return d;
+}
+
+/// lcp[i] is the common prefix of v[i - 1] and v[i], which share the first d chars
+template<typename T>
+void set_lcp(vector_view<T> v, vector_view<size_t> lcp, size_t d) {
+	for (size_t i = 1; i < v.size(); ++i) {
+		lcp[i] = string_lcp(v[i - 1], v[i], d);
+	}
+}
+
+/// strings up to this many are insertion sorted
+const size_t string_sort_base = 16;
+
+/// insertion sort of strings that share the first d chars
+template<typename T>
+void string_insertion_sort(vector_view<T> v, size_t d) {
+	for (size_t i = 1; i < v.size(); ++i) {
+		auto cur = std::move(v[i]);
+		auto j = i;
+		for (; j > 0; --j) {
+			const auto l = string_lcp(v[j - 1], cur, d);
+			if (string_char(v[j - 1], l) <= string_char(cur, l)) {
+				break;
+			}
+			v[j] = std::move(v[j - 1]);
+		}
+		v[j] = std::move(cur);
+	}
+}
+
+/// multikey quick sort of strings that share the first d chars,
+/// lcp is empty or has a place for every string of v
+template<typename T>
+void multikey_quick_sort(vector_view<T> v, vector_view<size_t> lcp, size_t d) {
+	ALGO_SORT_DEPTH();
+	const auto n = v.size();
+	if (n <= string_sort_base) {
+		string_insertion_sort(v, d);
+		if (!lcp.empty()) {
+			set_lcp(v, lcp, d);
+		}
+		return;
+	}
+
+	// median of three chars
+	auto a = string_char(v[0], d);
+	auto b = string_char(v[n / 2], d);
+	auto c = string_char(v[n - 1], d);
+	if (a > b) {
+		std::swap(a, b);
+	}
+	const auto pivot = c < a ? a : (c > b ? b : c);
+
+	// [0, lt) < pivot, [lt, i) == pivot, [gt, n) > pivot
+	size_t lt = 0;
+	size_t i = 0;
+	size_t gt = n;
+	while (i < gt) {
+		const auto ch = string_char(v[i], d);
+		if (ch < pivot) {
+			std::swap(v[lt], v[i]);
+			++lt;
+			++i;
+		}
+		else if (ch > pivot) {
+			--gt;
+			std::swap(v[i], v[gt]);
+		}
+		else {
+			++i;
+		}
+	}
+
+	// neighbors from different parts differ at char d
+	if (!lcp.empty()) {
+		if (lt > 0) {
+			lcp[lt] = d;
+		}
+		if (gt < n) {
+			lcp[gt] = d;
+		}
+	}
+	const auto part = [&](size_t from, size_t to) {
+		return lcp.empty() ? lcp : lcp.view(from, to);
+	};
+	multikey_quick_sort(v.view(0, lt), part(0, lt), d);
+	multikey_quick_sort(v.view(gt), part(gt, n), d);
+	if (pivot != 0) {
+		multikey_quick_sort(v.view(lt, gt), part(lt, gt), d + 1);
+	}
+	else if (!lcp.empty()) {
+		// the strings equal to the pivot ended, they are equal
+		for (auto j = lt + 1; j < gt; ++j) {
+			lcp[j] = d;
+		}
+	}
+}
+
+/// 3-way radix quick sort (Bentley, Sedgewick): partitions by one char into
+/// smaller, equal and larger strings and goes on with the next char only for
+/// the equal ones, so shared prefixes are looked at once instead of in every comparison.
+/// T is const char * or std::string, they are sorted like strcmp.
+template<typename T>
+void multikey_quick_sort(vector_view<T> v) {
+	multikey_quick_sort(v, vector_view<size_t>(), 0);
+}
+
+template<typename T>
+void multikey_quick_sort(vector<T>& v) {
+	multikey_quick_sort(v.view());
+}
+
+/// multikey_quick_sort that also fills lcp, which is as large as v, with the
+/// longest common prefixes of neighbors: lcp[0] = 0, lcp[i] of v[i - 1] and v[i]
+template<typename T>
+void multikey_quick_sort(vector_view<T> v, vector_view<size_t> lcp) {
+	assert(lcp.size() == v.size());
+	if (!lcp.empty()) {
+		lcp[0] = 0;
+	}
+	multikey_quick_sort(v, lcp, 0);
+}
+
+template<typename T>
+void multikey_quick_sort(vector<T>& v, vector<size_t>& lcp) {
+	lcp = vector<size_t>(v.size(), 0);
+	multikey_quick_sort(v.view(), lcp.view());
+}
+
+/// ranges up to this size are left to multikey_quick_sort
+const size_t msd_string_sort_base = 1 << 6;
+
+/// ranges from this size on are split by 2 chars at a time
+const size_t msd_string_sort_16bit = 1 << 16;
+
+/// the buffers of an msd_string_sort, as large as the strings
+template<typename T>
+struct msd_string_buffers {
+	vector_view<T> tmp;
+	vector_view<uint16_t> cache;
+};
+
+/// one distribution of strings that share the first d chars by the next 1 or 2 chars,
+/// which are read once into the cache, then the buckets are sorted recursively
+template<typename T>
+void msd_string_sort(vector_view<T> v, vector_view<size_t> lcp, size_t d, msd_string_buffers<T> buf) {
+	ALGO_SORT_DEPTH();
+	const auto n = v.size();
+	if (n <= msd_string_sort_base) {
+		multikey_quick_sort(v, lcp, d);
+		return;
+	}
+
+	// a 2 char digit of a string that ended at char d has no second char
+	const auto wide = n >= msd_string_sort_16bit;
+	const size_t buckets = wide ? 1 << 16 : 1 << 8;
+	auto cache = buf.cache.view(0, n);
+	vector<size_t> starts(buckets + 1, 0);
+	for (size_t i = 0; i < n; ++i) {
+		const auto c = string_char(v[i], d);
+		cache[i] = wide ? static_cast<uint16_t>(c << 8 | (c != 0 ? string_char(v[i], d + 1) : 0)) : c;
+		++starts[cache[i] + 1];
+	}
+	for (size_t b = 0; b < buckets; ++b) {
+		starts[b + 1] += starts[b];
+	}
+
+	auto tmp = buf.tmp.view(0, n);
+	{
+		vector<size_t> pos(starts);
+		for (size_t i = 0; i < n; ++i) {
+			tmp[pos[cache[i]]++] = std::move(v[i]);
+		}
+	}
+	for (size_t i = 0; i < n; ++i) {
+		v[i] = std::move(tmp[i]);
+	}
+
+	// the chars of a digit are all shared inside its bucket
+	const auto shared = [&](size_t b) {
+		if (!wide) {
+			return b == 0 ? d : d + 1;
+		}
+		return (b >> 8) == 0 ? d : ((b & 0xff) == 0 ? d + 1 : d + 2);
+	};
+	size_t prev = buckets;
+	for (size_t b = 0; b < buckets; ++b) {
+		const auto from = starts[b];
+		const auto to = starts[b + 1];
+		if (from == to) {
+			continue;
+		}
+		if (!lcp.empty() && prev != buckets) {
+			// neighbors from different buckets share d chars, d + 1 if their first chars match
+			lcp[from] = wide && (prev >> 8) == (b >> 8) ? d + 1 : d;
+		}
+		prev = b;
+		const auto next = shared(b);
+		const auto ended = wide ? (b >> 8) == 0 || (b & 0xff) == 0 : b == 0;
+		if (ended) {
+			// all strings of the bucket ended, they are equal
+			for (auto i = from + 1; !lcp.empty() && i < to; ++i) {
+				lcp[i] = next;
+			}
+		}
+		else {
+			msd_string_sort(v.view(from, to), lcp.empty() ? lcp : lcp.view(from, to), next,
+				msd_string_buffers<T>{buf.tmp.view(from, to), buf.cache.view(from, to)});
+		}
+	}
+}
+
+/// MSD radix sort of strings: reads the next char of every string once into a
+/// cache, the next 2 chars for large ranges, distributes the strings by it and
+/// sorts the buckets by the following chars. small ranges go to multikey_quick_sort.
+/// T is const char * or std::string, they are sorted like strcmp.
+/// needs a buffer of n strings and n 16 bit chars.
+template<typename T>
+void msd_string_sort(vector_view<T> v, vector_view<size_t> lcp) {
+	assert(lcp.empty() || lcp.size() == v.size());
+	if (!lcp.empty()) {
+		lcp[0] = 0;
+	}
+	ALGO_SORT_ALLOCATION(v.size() * (sizeof(T) + sizeof(uint16_t)));
+	vector<T> tmp(v.size(), T());
+	vector<uint16_t> cache(v.size(), 0);
+	msd_string_sort(v, lcp, 0, msd_string_buffers<T>{tmp.view(), cache.view()});
+}
+
+template<typename T>
+void msd_string_sort(vector_view<T> v) {
+	msd_string_sort(v, vector_view<size_t>());
+}
+
+template<typename T>
+void msd_string_sort(vector<T>& v) {
+	msd_string_sort(v.view());
+}
+
+/// msd_string_sort that also fills lcp like multikey_quick_sort does
+template<typename T>
+void msd_string_sort(vector<T>& v, vector<size_t>& lcp) {
+	lcp = vector<size_t>(v.size(), 0);
+	msd_string_sort(v.view(), lcp.view());
+}
+
+}
@@ -7,15 +7,36 @@
 #include "heap.h"
 #include "limited_heap.h"
 #include "search_tree.h"
+#include "btree.h"
+#include "hash_map.h"
+#include "concurrent_hash_map.h"
 
 #include "stack.h"
 #include "queue.h"
 #include "dequeue.h"
 
 #include "search.h"
+#include "static_search.h"
 #include "sort.h"
-
+#include "select.h"
+#include "merge.h"
+#include "external_sort.h"
+#include "sample_sort.h"
+#include "radix_sort.h"
+#include "fixed_string.h"
+#include "argsort.h"
+#include "string_sort.h"
+#include "block_merge_sort.h"
+#include "sort_probe.h"
+#include "auto_sort.h"
+#include "simd_sort.h"
+
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <numeric>
+#include <string>
+#include <thread>
 
 
 namespace algo {
@@ -80,6 +101,35 @@ static void vector_view_test() {
 	assert(view.size() == 100);
 	assert(view[0] == vec[100]);
 	assert(view[view.size() - 1] == vec[200 - 1]);
+
+	static_assert(std::is_trivially_copyable<vector_view<int>>::value, "a view is a pointer and a length");
+	static_assert(!std::is_constructible<vector_view<int>, vector_view<const int>>::value, "no const removal");
+
+	// memory the library does not own
+	int raw[N];
+	for (size_t i = 0; i < N; ++i) {
+		raw[i] = (i * 7919) % N;
+	}
+	vector_view<int> span(raw, N);
+	quick_sort(span);
+	assert(check_sorted(vector_view<const int>(span)));
+	heap_sort(span.view(0, 10));
+	insertion_sort(span.view(10, 20));
+	assert(*binary_search(span, 42) == 42);
+	assert(lower_bound(span, 500) == raw + 500);
+	assert(linear_search(span, N) == nullptr);
+
+	vector_view<const int> cspan = span;
+	assert(*binary_search(cspan, 7) == 7);
+	assert(select_k(cspan, 3).size() == 3);
+	cspan = vec.view(0, 1);
+	assert(cspan[0] == N);
+	assert(cspan.data() == vec.data());
+
+	const auto& cvec = vec;
+	vector_view<const int> all = cvec.view();
+	assert(all.size() == vec.size());
+	assert(count_equal(all, 5) == 1);
 }
 
 static void list_test() {
@@ -220,10 +270,11 @@ static void limited_heap_test() {
 	}
 }
 
+template<typename ST>
 static void search_tree_test() {
 	const auto N = 1000;
 	const auto K = 100;
-	binary_tree<int> tree;
+	ST tree;
 	assert(tree.empty());
 	assert(tree.find(10) == nullptr);
 	assert(tree.min() == nullptr);
@@ -285,6 +336,391 @@ static void search_tree_test() {
 	assert(*tree.max() == max2);
 }
 
+static void search_tree_test() {
+	search_tree_test<binary_tree<int>>();
+	search_tree_test<avl_tree<int>>();
+	search_tree_test<btree<int>>();
+	search_tree_test<btree<int, 4>>();
+
+	const auto N = 1000;
+	avl_tree<int> tree;
+	for (size_t i = 0; i < N; ++i) {
+		assert(tree.insert(i));
+	}
+	assert(tree.size() == N);
+	assert(tree.hight() <= 15);
+	for (size_t i = 0; i < N; ++i) {
+		assert(*tree.find(i) == i);
+	}
+
+	avl_tree<int> tree1 = tree;
+	for (size_t i = 0; i < N; i += 2) {
+		assert(tree.remove(i));
+	}
+	assert(tree.size() == N / 2);
+	assert(tree.hight() <= 14);
+	assert(tree.find(0) == nullptr);
+	assert(*tree.min() == 1);
+	assert(*tree.max() == N - 1);
+	assert(tree1.size() == N);
+	assert(*tree1.find(0) == 0);
+
+	for (size_t i = 0; i < N / 2; ++i) {
+		assert(*tree.select(i) == 2 * i + 1);
+		assert(tree.rank(2 * i + 1) == i);
+		assert(tree.rank(2 * i + 2) == i + 1);
+	}
+	assert(tree.select(N / 2) == nullptr);
+	assert(tree.rank(-1) == 0);
+
+	avl_tree<int> stats;
+	vector<int> sorted;
+	for (size_t i = 0; i < N; ++i) {
+		const int v = rand() % N;
+		if (rand() % 2 == 0) {
+			stats.remove(v);
+		}
+		else {
+			stats.insert(v);
+		}
+	}
+	for (const auto& v : stats) {
+		sorted.push_back(v);
+	}
+	for (size_t i = 0; i < sorted.size(); ++i) {
+		assert(*stats.select(i) == sorted[i]);
+		assert(stats.rank(sorted[i]) == i);
+	}
+}
+
+template<typename BT>
+static void btree_test() {
+	const auto N = 5000;
+	BT tree;
+	avl_tree<int> check;
+	for (size_t i = 0; i < 4 * N; ++i) {
+		const int v = rand() % N;
+		if (rand() % 3 == 0) {
+			assert(tree.remove(v) == check.remove(v));
+		}
+		else {
+			assert(tree.insert(v) == check.insert(v));
+		}
+		assert(tree.size() == check.size());
+	}
+
+	vector<int> sorted;
+	for (const auto& v : tree) {
+		assert(sorted.empty() || sorted.back() < v);
+		assert(check.find(v) != nullptr);
+		sorted.push_back(v);
+	}
+	assert(sorted.size() == tree.size());
+	assert(*tree.min() == sorted.front());
+	assert(*tree.max() == sorted.back());
+
+	for (int v = -1; v <= N; ++v) {
+		const auto it = tree.lower_bound(v);
+		const auto * lb = check.find(v);
+		if (lb != nullptr) {
+			assert(*it == v);
+			assert(*tree.find(v) == v);
+		}
+		else {
+			assert(tree.find(v) == nullptr);
+			assert(it == tree.end() || *it > v);
+		}
+		const auto ut = tree.upper_bound(v);
+		assert(ut == tree.end() || *ut > v);
+	}
+
+	BT bulk(sorted);
+	assert(bulk.size() == sorted.size());
+	size_t idx = 0;
+	for (auto it = bulk.lower_bound(sorted[0]); it != bulk.end(); ++it, ++idx) {
+		assert(*it == sorted[idx]);
+	}
+	assert(idx == sorted.size());
+	for (size_t i = 0; i < sorted.size(); i += 2) {
+		assert(bulk.remove(sorted[i]));
+	}
+	for (size_t i = 0; i < sorted.size(); ++i) {
+		assert((bulk.find(sorted[i]) != nullptr) == (i % 2 == 1));
+	}
+
+	BT copy = bulk;
+	assert(copy.size() == bulk.size());
+	while (!bulk.empty()) {
+		assert(bulk.remove(*bulk.min()));
+	}
+	assert(bulk.hight() == 0);
+	assert(copy.find(sorted[1]) != nullptr);
+}
+
+static void btree_test() {
+	btree_test<btree<int>>();
+	btree_test<btree<int, 3>>();
+	btree_test<btree<int, 4>>();
+
+	btree_map<int, int> map;
+	for (int i = 0; i < 1000; ++i) {
+		assert(map.insert(i, -i));
+	}
+	assert(!map.insert(10, 10));
+	assert(*map.find(10) == -10);
+	assert(map.remove(10));
+	assert(map.find(10) == nullptr);
+	assert(map.size() == 999);
+}
+
+template<typename ST>
+static void tree_iterator_test() {
+	const auto N = 1000;
+	ST tree;
+	assert(tree.begin() == tree.end());
+	for (size_t i = 0; i < N; ++i) {
+		tree.insert((rand() % N) * 2);
+	}
+
+	size_t cnt = 0;
+	int prev = -1;
+	for (const auto& v : tree) {
+		assert(prev < v);
+		prev = v;
+		++cnt;
+	}
+	assert(cnt == tree.size());
+
+	for (int v = -1; v <= 2 * N; ++v) {
+		const auto lb = tree.lower_bound(v);
+		const auto ub = tree.upper_bound(v);
+		if (tree.find(v) != nullptr) {
+			assert(*lb == v);
+			assert(ub == tree.end() || *ub > v);
+			assert(++tree.lower_bound(v) == ub);
+		}
+		else {
+			assert(lb == ub);
+			assert(lb == tree.end() || *lb > v);
+		}
+	}
+
+	const auto r = tree.range(N / 2, N);
+	for (const auto& v : r) {
+		assert(v >= N / 2 && v < N);
+	}
+	assert(std::distance(r.begin(), r.end()) == std::count_if(tree.begin(), tree.end(), [](int v) {
+		return v >= N / 2 && v < N;
+	}));
+}
+
+/// walks tree backwards and through copies, after inserts and removes moved nodes around
+template<typename ST>
+static void tree_bidirectional_test() {
+	const auto N = 1000;
+	ST tree;
+	assert(tree.begin() == tree.end());
+	vector<int> vals;
+	for (size_t i = 0; i < N; ++i) {
+		const auto v = rand() % N;
+		if (tree.insert(v)) {
+			vals.push_back(v);
+		}
+	}
+	for (size_t i = 0; i < vals.size(); i += 3) {
+		assert(tree.remove(vals[i]));
+	}
+	for (size_t i = 0; i < N / 4; ++i) {
+		tree.insert(rand() % N);
+	}
+	const auto copy = tree;
+	const ST * trees[] = {&tree, &copy};
+	for (const auto * t : trees) {
+		vector<int> forward;
+		for (const auto& v : *t) {
+			forward.push_back(v);
+		}
+		assert(forward.size() == t->size() && check_sorted(forward));
+		auto it = t->end();
+		for (size_t i = forward.size(); i > 0; --i) {
+			--it;
+			assert(*it == forward[i - 1]);
+		}
+		assert(it == t->begin());
+		for (size_t i = 0; i < forward.size(); ++i) {
+			auto lb = t->lower_bound(forward[i]);
+			assert(*lb-- == forward[i]);
+			assert(i == 0 || *lb == forward[i - 1]);
+		}
+	}
+}
+
+static void iterator_test() {
+	const auto N = 1000;
+	{
+		vector<int> vec;
+		for (size_t i = 0; i < N; ++i) {
+			vec.push_back(N - i);
+		}
+		std::sort(vec.begin(), vec.end());
+		assert(check_sorted(vec));
+		const auto& cvec = vec;
+		assert(std::accumulate(cvec.begin(), cvec.end(), 0) == N * (N + 1) / 2);
+	}
+	{
+		list<int> lst;
+		for (size_t i = 0; i < N; ++i) {
+			lst.push_front(i);
+		}
+		int expected = N - 1;
+		for (auto& v : lst) {
+			assert(v == expected);
+			--expected;
+			v *= 2;
+		}
+		const auto& clst = lst;
+		list<int>::const_iterator it = lst.begin();
+		assert(*it == 2 * (N - 1));
+		assert(std::find(clst.begin(), clst.end(), 42) != clst.end());
+		assert(std::find(clst.begin(), clst.end(), 43) == clst.end());
+	}
+	{
+		dlist<int> lst;
+		for (size_t i = 0; i < N; ++i) {
+			lst.push_back(i);
+		}
+		int expected = 0;
+		for (const auto& v : lst) {
+			assert(v == expected);
+			++expected;
+		}
+		auto it = lst.end();
+		for (int i = N - 1; i >= 0; --i) {
+			--it;
+			assert(*it == i);
+		}
+		assert(it == lst.begin());
+		const auto& clst = lst;
+		assert(std::accumulate(clst.begin(), clst.end(), 0) == N * (N - 1) / 2);
+	}
+
+	tree_iterator_test<binary_tree<int>>();
+	tree_iterator_test<avl_tree<int>>();
+	tree_iterator_test<btree<int>>();
+	tree_iterator_test<btree<int, 4>>();
+	tree_bidirectional_test<binary_tree<int>>();
+	tree_bidirectional_test<avl_tree<int>>();
+}
+
+static void hash_map_test() {
+	const auto N = 5000;
+	hash_set<int> set;
+	avl_tree<int> check;
+	assert(set.find(1) == nullptr);
+	for (size_t i = 0; i < 4 * N; ++i) {
+		const int v = rand() % N;
+		if (rand() % 3 == 0) {
+			assert(set.remove(v) == check.remove(v));
+		}
+		else {
+			assert(set.insert(v) == check.insert(v));
+		}
+		assert(set.size() == check.size());
+	}
+	for (int v = 0; v < N; ++v) {
+		assert((set.find(v) != nullptr) == (check.find(v) != nullptr));
+	}
+	size_t cnt = 0;
+	for (const auto& v : set) {
+		assert(check.find(v) != nullptr);
+		++cnt;
+	}
+	assert(cnt == set.size());
+
+	hash_set<int> copy = set;
+	assert(copy.size() == set.size());
+	const auto cap = set.capacity();
+	set.rehash(2 * cap);
+	assert(set.capacity() == 2 * cap);
+	for (const auto& v : check) {
+		assert(*set.find(v) == v);
+		assert(copy.contains(v));
+	}
+	set.clear();
+	assert(set.empty() && set.find(0) == nullptr);
+	set.reserve(1000);
+	const auto reserved = set.capacity();
+	for (int i = 0; i < 1000; ++i) {
+		set.insert(i);
+	}
+	assert(set.capacity() == reserved);
+
+	struct mod_hash {
+		size_t operator()(int v) const {
+			return v % 3;
+		}
+	};
+	hash_map<int, int, mod_hash> map;
+	for (int i = 0; i < 1000; ++i) {
+		assert(map.insert(i, -i));
+	}
+	assert(!map.insert(10, 10));
+	assert(*map.find(10) == -10);
+	assert(map.remove(10));
+	assert(map.find(10) == nullptr);
+	assert(map.size() == 999);
+	map[10] = 7;
+	++map[10];
+	assert(*map.find(10) == 8);
+	assert(map[2000] == 0);
+	assert(map.size() == 1001);
+}
+
+static void concurrent_hash_map_test() {
+	const int N = 10000;
+	const int Threads = 4;
+	concurrent_hash_map<int, int> map;
+	vector<std::thread> threads;
+	for (int t = 0; t < Threads; ++t) {
+		threads.push_back(std::thread([&map, t]() {
+			for (int i = t; i < N; i += Threads) {
+				assert(map.insert(i, -i));
+			}
+			// every thread reads the others' keys while they are inserted
+			for (int i = 0; i < N; ++i) {
+				int v = 0;
+				if (map.find(i, v)) {
+					assert(v == -i);
+				}
+			}
+			for (int i = t; i < N; i += 2 * Threads) {
+				assert(map.remove(i));
+			}
+		}));
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+	assert(map.size() == N / 2);
+	for (int i = 0; i < N; ++i) {
+		assert(map.contains(i) == (i % (2 * Threads) >= Threads));
+	}
+
+	vector<pair<int, int>> batch;
+	for (int i = 0; i < N; ++i) {
+		batch.push_back(pair<int, int>(i, i));
+	}
+	assert(map.upsert(batch) == N / 2);
+	assert(map.size() == N);
+	int v = 0;
+	assert(map.find(7, v) && v == 7);
+	assert(!map.upsert(7, 8));
+	assert(map.find(7, v) && v == 8);
+	assert(!map.insert(7, 9));
+	assert(map.find(7, v) && v == 8);
+	assert(!map.find(N, v));
+}
+
 template<typename ST>
 static void stack_test() {
 	ST stack;
@@ -359,7 +795,47 @@ static void dequeue_test() {
 	assert(que.empty());
 }
 
+template<typename T>
+static void linear_search_test() {
+	for (size_t n = 0; n < 300; n += 1 + n / 8) {
+		vector<T> vec;
+		for (size_t i = 0; i < n; ++i) {
+			vec.push_back(static_cast<T>(i % 37));
+		}
+		for (int v = -1; v <= 37; ++v) {
+			const auto val = static_cast<T>(v);
+			T * expected = nullptr;
+			vector<size_t> all;
+			for (size_t i = 0; i < n; ++i) {
+				if (vec[i] == val) {
+					if (expected == nullptr) {
+						expected = &vec[i];
+					}
+					all.push_back(i);
+				}
+			}
+			assert(linear_search(vec, val) == expected);
+			assert(find_first_scalar(vec.data(), n, val) == (expected == nullptr ? n : expected - vec.data()));
+			assert(count_equal(vec, val) == all.size());
+			assert(find_all(vec, val) == all);
+			if (n > 3) {
+				auto view = vec.view(3);
+				auto * res = linear_search(view, val);
+				assert(res == nullptr || *res == val);
+			}
+		}
+	}
+}
+
 static void search_test() {
+	linear_search_test<int>();
+	linear_search_test<unsigned>();
+	linear_search_test<char>();
+	linear_search_test<short>();
+	linear_search_test<long long>();
+	linear_search_test<float>();
+	linear_search_test<double>();
+
 	const auto N = 1000;
 	{
 
@@ -380,9 +856,95 @@ static void search_test() {
 		assert(linear_search(vec, 44) == &vec[N - 44]);
 		assert(linear_search(vec, 2000) == nullptr);
 	}
+	{
+		vector<int> vec;
+		for (size_t i = 0; i <= N; ++i) {
+			vec.push_back(rand() % (N / 4) * 2);
+		}
+		merge_sort(vec);
+		for (int v = -1; v <= N / 2 + 1; ++v) {
+			auto * lb = lower_bound(vec, v);
+			auto * ub = upper_bound(vec, v);
+			assert(lb == std::lower_bound(vec.begin(), vec.end(), v));
+			assert(ub == std::upper_bound(vec.begin(), vec.end(), v));
+			const auto range = equal_range(vec, v);
+			assert(range.first == lb && range.second == ub);
+			if (lb == ub) {
+				assert(binary_search(vec, v) == nullptr);
+			}
+			else {
+				assert(binary_search(vec, v) == lb);
+			}
+		}
+
+		vector<int> needles;
+		for (size_t i = 0; i < N; ++i) {
+			needles.push_back(rand() % (N / 2 + 2) - 1);
+		}
+		for (size_t pass = 0; pass < 2; ++pass) {
+			vector<size_t> out;
+			batch_search(vec, needles, out);
+			assert(out.size() == needles.size());
+			for (size_t i = 0; i < needles.size(); ++i) {
+				auto * res = binary_search(vec, needles[i]);
+				assert(out[i] == (res == nullptr ? vec.size() : res - vec.data()));
+			}
+			merge_sort(needles);
+		}
+		{
+			vector<size_t> out;
+			batch_search(vector<int>(), needles, out);
+			assert(out.size() == needles.size() && out[0] == 0);
+		}
+
+		for (size_t n = 0; n < 10; ++n) {
+			auto view = vec.view(0, n);
+			assert(lower_bound(view, N) == view.data() + n);
+			assert(upper_bound(view, -1) == view.data());
+		}
+	}
 
 }
 
+template<typename SI>
+static void static_search_test(const vector<int>& sorted) {
+	SI index(sorted);
+	assert(index.size() == sorted.size());
+	const auto max = sorted.empty() ? 0 : sorted.back();
+	for (int v = -1; v <= max + 1; ++v) {
+		const auto * expected = std::lower_bound(sorted.begin(), sorted.end(), v);
+		const auto * res = lower_bound(index, v);
+		if (expected == sorted.end()) {
+			assert(res == nullptr);
+		}
+		else {
+			assert(res != nullptr && *res == *expected);
+		}
+		const auto * found = binary_search(index, v);
+		assert((found != nullptr) == (expected != sorted.end() && *expected == v));
+	}
+}
+
+static void static_search_test() {
+	for (size_t n = 0; n < 300; n += 1 + n / 4) {
+		vector<int> sorted;
+		for (size_t i = 0; i < n; ++i) {
+			sorted.push_back(3 * i + 1);
+		}
+		static_search_test<eytzinger_index<int>>(sorted);
+		static_search_test<stree_index<int>>(sorted);
+		static_search_test<stree_index<int, 3>>(sorted);
+	}
+
+	vector<int> dups;
+	for (size_t i = 0; i < 1000; ++i) {
+		dups.push_back(rand() % 100);
+	}
+	merge_sort(dups);
+	static_search_test<eytzinger_index<int>>(dups);
+	static_search_test<stree_index<int>>(dups);
+}
+
 template<typename T>
 static void sort_test(const vector<T>& vec, bool sorted = false) {
 	assert(sorted == check_sorted(vec));
@@ -443,19 +1005,31 @@ static void sort_test(const vector<T>& vec, bool sorted = false) {
 	}
 	{
 		auto tmp = vec;
-		counting_sort(tmp);
+		intro_sort(tmp);
 		assert(check_sorted(tmp));
 		assert(tmp == correct);
 	}
 	{
 		auto tmp = vec;
-		lsd_radix_sort(tmp);
+		three_way_quick_sort(tmp);
+		assert(check_sorted(tmp));
+		assert(tmp == correct);
+	}
+	{
+		auto tmp = vec;
+		natural_merge_sort(tmp);
+		assert(check_sorted(tmp));
+		assert(tmp == correct);
+	}
+	{
+		auto tmp = vec;
+		counting_sort(tmp);
 		assert(check_sorted(tmp));
 		assert(tmp == correct);
 	}
 	{
 		auto tmp = vec;
-		lsd_radix_sort<T, 2>(tmp);
+		lsd_radix_sort(tmp);
 		assert(check_sorted(tmp));
 		assert(tmp == correct);
 	}
@@ -467,7 +1041,7 @@ static void sort_test(const vector<T>& vec, bool sorted = false) {
 	}
 	{
 		auto tmp = vec;
-		msd_radix_sort<T, 2>(tmp);
+		msd_radix_sort_bin(tmp);
 		assert(check_sorted(tmp));
 		assert(tmp == correct);
 	}
@@ -521,6 +1095,916 @@ static void sort_test() {
 	}
 }
 
+struct greater {
+	bool operator()(int a, int b) const {
+		return a > b;
+	}
+};
+
+static void sort_order_test() {
+	// descending by a comparator, by the second element through a projection
+	vector<pair<int, int>> vec;
+	for (int i = 0; i < 300; ++i) {
+		vec.push_back(pair<int, int>(i, rand() % 50));
+	}
+	const auto second = [](const pair<int, int>& p) {
+		return p.second;
+	};
+	const auto check = [&](const vector<pair<int, int>>& res, bool stable) {
+		assert(res.size() == vec.size());
+		assert(check_sorted(res, greater(), second));
+		for (size_t i = 1; i < res.size(); ++i) {
+			assert(!stable || res[i - 1].second != res[i].second || res[i - 1].first < res[i].first);
+		}
+	};
+	const auto sorted = [&](void (*f)(vector<pair<int, int>>&)) {
+		auto tmp = vec;
+		f(tmp);
+		return tmp;
+	};
+	check(sorted([](vector<pair<int, int>>& v) { selection_sort(v, greater(), [](const pair<int, int>& p) { return p.second; }); }), false);
+	check(sorted([](vector<pair<int, int>>& v) { insertion_sort(v, greater(), [](const pair<int, int>& p) { return p.second; }); }), true);
+	check(sorted([](vector<pair<int, int>>& v) { bubble_sort(v, greater(), [](const pair<int, int>& p) { return p.second; }); }), true);
+	check(sorted([](vector<pair<int, int>>& v) { merge_sort(v, greater(), [](const pair<int, int>& p) { return p.second; }); }), true);
+	check(sorted([](vector<pair<int, int>>& v) { quick_sort(v, greater(), [](const pair<int, int>& p) { return p.second; }); }), false);
+	check(sorted([](vector<pair<int, int>>& v) { copy_quick_sort(v, greater(), [](const pair<int, int>& p) { return p.second; }); }), false);
+	check(sorted([](vector<pair<int, int>>& v) { heap_sort(v, greater(), [](const pair<int, int>& p) { return p.second; }); }), false);
+	check(sorted([](vector<pair<int, int>>& v) { intro_sort(v, greater(), [](const pair<int, int>& p) { return p.second; }); }), false);
+	check(sorted([](vector<pair<int, int>>& v) { natural_merge_sort(v, greater(), [](const pair<int, int>& p) { return p.second; }); }), true);
+	check(sorted([](vector<pair<int, int>>& v) { three_way_quick_sort(v, greater(), [](const pair<int, int>& p) { return p.second; }); }), false);
+	check(sorted([](vector<pair<int, int>>& v) {
+		quick_sort(v, middle_pivot_strategy<pair<int, int>>, greater(), [](const pair<int, int>& p) { return p.second; });
+	}), false);
+
+	vector<int> ints;
+	for (int i = 0; i < 300; ++i) {
+		ints.push_back(rand() % 100);
+	}
+	quick_sort(ints, greater());
+	assert(check_sorted(ints, greater()));
+	heap_sort(ints);
+	assert(check_sorted(ints));
+}
+
+template<typename T>
+static void select_test(const vector<T>& vec) {
+	auto sorted = vec;
+	merge_sort(sorted);
+	for (size_t n = 0; n < vec.size(); n += 1 + vec.size() / 17) {
+		{
+			auto tmp = vec;
+			nth_element(tmp, n);
+			assert(tmp[n] == sorted[n]);
+			for (size_t i = 0; i < n; ++i) {
+				assert(!(tmp[n] < tmp[i]));
+			}
+			for (size_t i = n + 1; i < tmp.size(); ++i) {
+				assert(!(tmp[i] < tmp[n]));
+			}
+		}
+		{
+			auto tmp = vec;
+			nth_element_mom(tmp, n);
+			assert(tmp[n] == sorted[n]);
+		}
+		{
+			auto tmp = vec;
+			partial_sort(tmp, n);
+			for (size_t i = 0; i < n; ++i) {
+				assert(tmp[i] == sorted[i]);
+			}
+		}
+		{
+			auto res = select_k(vec, n);
+			assert(res.size() == n);
+			merge_sort(res);
+			for (size_t i = 0; i < n; ++i) {
+				assert(res[i] == sorted[i]);
+			}
+		}
+	}
+}
+
+static void select_test() {
+	const auto N = 1000;
+	{
+		vector<int> vec;
+		for (size_t i = 0; i <= N; ++i) {
+			vec.push_back(i);
+		}
+		select_test(vec);
+	}
+	{
+		vector<int> vec;
+		for (size_t i = 0; i <= N; ++i) {
+			vec.push_back(N - i);
+		}
+		select_test(vec);
+	}
+	{
+		vector<int> vec;
+		for (size_t i = 0; i <= N; ++i) {
+			vec.push_back(rand() % 1000);
+		}
+		select_test(vec);
+	}
+	{
+		vector<int> vec;
+		for (size_t i = 0; i <= N; ++i) {
+			vec.push_back(rand() % 3);
+		}
+		select_test(vec);
+	}
+}
+
+static void merge_test() {
+	const size_t ks[] = {0, 1, 2, 3, 5, 8, 17, 64};
+	for (auto k : ks) {
+		// pairs compare by key only, the value records where an element came from
+		vector<vector<pair<int, int>>> runs;
+		vector<int> all;
+		for (size_t i = 0; i < k; ++i) {
+			const auto n = i % 4 == 1 ? 0 : rand() % 200;
+			vector<pair<int, int>> run;
+			for (size_t j = 0; j < n; ++j) {
+				run.push_back(pair<int, int>(rand() % 50, static_cast<int>(i * 1000 + j)));
+			}
+			quick_sort(run);
+			for (size_t j = 0; j < n; ++j) {
+				run[j].second = static_cast<int>(i * 1000 + j);
+				all.push_back(run[j].first);
+			}
+			runs.push_back(run);
+		}
+		vector<vector_view<const pair<int, int>>> inputs;
+		for (size_t i = 0; i < k; ++i) {
+			inputs.push_back(runs[i].view());
+		}
+
+		vector<pair<int, int>> res;
+		multiway_merge(inputs, res);
+		quick_sort(all);
+		assert(res.size() == all.size());
+		for (size_t i = 0; i < res.size(); ++i) {
+			assert(res[i].first == all[i]);
+			// stable: equal keys in input order
+			assert(i == 0 || res[i - 1].first < res[i].first || res[i - 1].second < res[i].second);
+		}
+	}
+
+	// stable parallel merges, the value of a pair is its input and position
+	for (size_t m = 1; m <= 5; ++m) {
+		vector<vector<pair<int, int>>> runs;
+		vector<vector_view<const pair<int, int>>> inputs;
+		for (size_t i = 0; i < m; ++i) {
+			vector<pair<int, int>> run;
+			const auto n = i == 1 ? 0 : 20000 + rand() % 20000;
+			for (size_t j = 0; j < n; ++j) {
+				run.push_back(pair<int, int>(rand() % 100, 0));
+			}
+			quick_sort(run);
+			for (size_t j = 0; j < n; ++j) {
+				run[j].second = static_cast<int>(i * 100000 + j);
+			}
+			runs.push_back(run);
+		}
+		for (size_t i = 0; i < m; ++i) {
+			inputs.push_back(runs[i].view());
+		}
+		vector<pair<int, int>> expected;
+		multiway_merge(inputs, expected);
+		for (size_t threads = 1; threads <= 7; threads += 3) {
+			vector<pair<int, int>> res;
+			parallel_multiway_merge(inputs, res, threads);
+			assert(res.size() == expected.size());
+			for (size_t i = 0; i < res.size(); ++i) {
+				assert(res[i].first == expected[i].first && res[i].second == expected[i].second);
+			}
+		}
+		for (size_t k = 0; k <= expected.size(); k += 997) {
+			vector<size_t> pos;
+			multiway_co_rank(inputs, k, pos);
+			assert(std::accumulate(pos.begin(), pos.end(), static_cast<size_t>(0)) == k);
+		}
+	}
+	{
+		vector<int> l;
+		vector<int> r;
+		for (size_t i = 0; i < 1000; ++i) {
+			l.push_back(2 * i);
+			r.push_back(i < 500 ? 2 * i + 1 : 2 * i);
+		}
+		for (size_t k = 0; k <= l.size() + r.size(); ++k) {
+			const auto i = co_rank(const_view_t<int>(l), const_view_t<int>(r), k);
+			assert(i <= k && i <= l.size() && k - i <= r.size());
+			assert(i == 0 || k - i == r.size() || !(r[k - i] < l[i - 1]));
+			assert(i == l.size() || k == i || r[k - i - 1] < l[i]);
+		}
+		vector<int> out(l.size() + r.size(), 0);
+		parallel_merge(l, r, out.view(), 3);
+		assert(check_sorted(out));
+	}
+
+	vector<pair<int, int>> big;
+	for (size_t i = 0; i < 100000; ++i) {
+		big.push_back(pair<int, int>(rand() % 1000, static_cast<int>(i)));
+	}
+	for (size_t threads = 1; threads <= 4; ++threads) {
+		auto tmp = big;
+		parallel_merge_sort(tmp, threads);
+		for (size_t i = 1; i < tmp.size(); ++i) {
+			assert(tmp[i - 1].first < tmp[i].first || (tmp[i - 1].first == tmp[i].first && tmp[i - 1].second < tmp[i].second));
+		}
+	}
+
+	loser_tree<int> tree(3);
+	tree.reset(2, 1);
+	tree.reset(0, 5);
+	tree.build();
+	assert(tree.top() == 2 && tree.min() == 1);
+	tree.replace(7);
+	assert(tree.top() == 0 && tree.min() == 5);
+	tree.pop();
+	assert(tree.top() == 2 && tree.min() == 7);
+	tree.pop();
+	assert(tree.empty());
+}
+
+template<typename T>
+static void external_sort_test(const vector<T>& vec, size_t memory_bytes) {
+	char in_path[] = "/tmp/algo_test_in_XXXXXX";
+	char out_path[] = "/tmp/algo_test_out_XXXXXX";
+	file_handle in(mkstemp(in_path));
+	file_handle out(mkstemp(out_path));
+	assert(in.valid() && out.valid());
+	assert(pwrite_all(in.get(), vec.data(), vec.size() * sizeof(T), 0));
+
+	external_sort_stats stats;
+	assert(external_sort<T>(in_path, out_path, memory_bytes, stats));
+	assert(stats.records == vec.size());
+	const auto bytes = vec.size() * sizeof(T);
+	assert(stats.bytes_read == stats.passes * bytes);
+	assert(stats.bytes_written == stats.passes * bytes);
+	if (bytes <= memory_bytes) {
+		assert(stats.passes <= 1);
+	}
+	else {
+		assert(stats.runs > 1 && stats.passes > 1);
+	}
+
+	vector<T> res(vec.size(), T{});
+	struct stat st;
+	assert(fstat(out.get(), &st) == 0 && static_cast<size_t>(st.st_size) == bytes);
+	assert(pread_all(out.get(), res.data(), bytes, 0));
+	auto sorted = vec;
+	quick_sort(sorted);
+	for (size_t i = 0; i < vec.size(); ++i) {
+		assert(res[i] == sorted[i]);
+	}
+	unlink(in_path);
+	unlink(out_path);
+}
+
+static void external_sort_test() {
+	vector<int> vec;
+	for (size_t i = 0; i < 100000; ++i) {
+		vec.push_back(rand() % 50000 - 25000);
+	}
+	// a single run, 2 way merges of many runs and a single merge pass
+	external_sort_test(vec, 1 << 20);
+	external_sort_test(vec, 4 << 10);
+	external_sort_test(vec, 64 << 10);
+	external_sort_test(vector<int>(), 1 << 10);
+
+	vector<uint64_t> big;
+	for (size_t i = 0; i < 20000; ++i) {
+		big.push_back(static_cast<uint64_t>(rand()) << 32 | rand());
+	}
+	external_sort_test(big, 16 << 10);
+
+	external_sort_stats stats;
+	assert(!external_sort<int>("/nonexistent/algo_test", "/tmp/algo_test_never", 1 << 10, stats));
+
+	// in place, as a single run and through merge passes
+	auto sorted = vec;
+	quick_sort(sorted);
+	const size_t memories[] = {1 << 20, 64 << 10};
+	for (auto memory : memories) {
+		char path[] = "/tmp/algo_test_in_XXXXXX";
+		{
+			file_handle f(mkstemp(path));
+			assert(f.valid() && fchmod(f.get(), 0640) == 0);
+			assert(pwrite_all(f.get(), vec.data(), vec.size() * sizeof(int), 0));
+		}
+		assert(external_sort<int>(path, path, memory, stats));
+		file_handle f(open(path, O_RDONLY));
+		struct stat st;
+		assert(fstat(f.get(), &st) == 0 && static_cast<size_t>(st.st_size) == vec.size() * sizeof(int));
+		assert((st.st_mode & 0777) == 0640);
+		vector<int> res(vec.size(), 0);
+		assert(pread_all(f.get(), res.data(), vec.size() * sizeof(int), 0));
+		assert(res == sorted);
+		unlink(path);
+	}
+}
+
+template<typename T>
+static void sample_sort_test(const vector<T>& vec) {
+	auto sorted = vec;
+	quick_sort(sorted);
+	auto res = vec;
+	sample_sort(res);
+	for (size_t i = 0; i < vec.size(); ++i) {
+		assert(res[i] == sorted[i]);
+	}
+	for (size_t threads = 2; threads <= 5; threads += 3) {
+		res = vec;
+		parallel_sample_sort(res, threads);
+		for (size_t i = 0; i < vec.size(); ++i) {
+			assert(res[i] == sorted[i]);
+		}
+	}
+}
+
+static void sample_sort_test() {
+	// sizes around the base case and block boundaries, few distinct values use equality buckets
+	const size_t ns[] = {0, 1, 4097, 16385, 70001, 300000};
+	for (auto n : ns) {
+		vector<int> random;
+		vector<int> few;
+		vector<int> sorted;
+		for (size_t i = 0; i < n; ++i) {
+			random.push_back(rand());
+			few.push_back(rand() % 3 == 0 ? rand() : 7);
+			sorted.push_back(static_cast<int>(i));
+		}
+		sample_sort_test(random);
+		sample_sort_test(few);
+		sample_sort_test(sorted);
+		sample_sort_test(vector<int>(n, 1));
+	}
+
+	vector<uint64_t> big;
+	for (size_t i = 0; i < 100000; ++i) {
+		big.push_back(static_cast<uint64_t>(rand()) << 32 | rand());
+	}
+	sample_sort_test(big);
+
+	vector<int> splitters;
+	for (int s = 10; s <= 30; s += 10) {
+		splitters.push_back(s);
+	}
+	splitter_tree<int> tree(splitters.view(), 2, true);
+	assert(tree.buckets() == 8);
+	assert(tree(5) == 0 && tree(10) == 1 && tree(15) == 2 && tree(20) == 3 && tree(30) == 5 && tree(31) == 6);
+}
+
+template<typename T>
+static void radix_sort_test(const vector<T>& vec) {
+	auto sorted = vec;
+	quick_sort(sorted);
+	for (size_t threads = 1; threads <= 4; threads += 3) {
+		auto res = vec;
+		parallel_radix_sort(res, threads);
+		for (size_t i = 0; i < vec.size(); ++i) {
+			assert(res[i] == sorted[i]);
+		}
+	}
+	void (*sorts[])(vector<T>&) = {
+		[](vector<T>& v) { lsd_radix_sort(v); },
+		[](vector<T>& v) { msd_radix_sort(v); },
+		[](vector<T>& v) { msd_radix_sort_bin(v); },
+	};
+	for (auto sort : sorts) {
+		auto res = vec;
+		sort(res);
+		for (size_t i = 0; i < vec.size(); ++i) {
+			assert(res[i] == sorted[i]);
+		}
+	}
+}
+
+static void radix_sort_test() {
+	// the base case, one or more threads, skipped passes and an odd number of passes
+	const size_t ns[] = {0, 1, 1000, 5000, 300001};
+	for (auto n : ns) {
+		vector<uint32_t> small;
+		vector<uint32_t> odd;
+		vector<uint64_t> big;
+		for (size_t i = 0; i < n; ++i) {
+			small.push_back(rand() % 200);
+			odd.push_back(rand() % 100000 << 8);
+			big.push_back(static_cast<uint64_t>(rand()) << 32 | rand());
+		}
+		radix_sort_test(small);
+		radix_sort_test(odd);
+		radix_sort_test(big);
+	}
+	radix_sort_test(vector<uint8_t>(100000, 3));
+
+	// the key types of radix_key
+	vector<int64_t> ints;
+	vector<double> doubles;
+	vector<float> floats;
+	vector<fixed_string<5>> strings;
+	for (size_t i = 0; i < 100000; ++i) {
+		ints.push_back((static_cast<int64_t>(rand()) << 32 | rand()) * (rand() % 2 == 0 ? 1 : -1));
+		doubles.push_back((rand() - RAND_MAX / 2) / 1000.0);
+		floats.push_back(static_cast<float>(doubles.back() * 1e30));
+		char chars[6];
+		for (size_t c = 0; c < 5; ++c) {
+			chars[c] = static_cast<char>('a' + rand() % 30);
+		}
+		chars[rand() % 6] = 0;
+		strings.push_back(fixed_string<5>(chars));
+	}
+	radix_sort_test(ints);
+	radix_sort_test(doubles);
+	radix_sort_test(floats);
+	radix_sort_test(strings);
+	vector<int> small_ints;
+	for (size_t i = 0; i < 500; ++i) {
+		small_ints.push_back(static_cast<int>(ints[i] >> 32));
+	}
+	radix_sort_test(small_ints);
+
+	// pairs by their first element, stable
+	vector<pair<int8_t, int>> pairs;
+	for (int i = 0; i < 5000; ++i) {
+		pairs.push_back(pair<int8_t, int>(static_cast<int8_t>(rand()), i));
+	}
+	parallel_radix_sort(pairs, 2);
+	for (size_t i = 1; i < pairs.size(); ++i) {
+		assert(pairs[i - 1].first < pairs[i].first || (pairs[i - 1].first == pairs[i].first && pairs[i - 1].second < pairs[i].second));
+	}
+
+	// by a projection, negative floats and zeros
+	vector<pair<int, float>> by_second;
+	for (int i = 0; i < 3000; ++i) {
+		by_second.push_back(pair<int, float>(i, i % 3 == 0 ? -0.0f : (rand() % 200 - 100) / 7.0f));
+	}
+	parallel_radix_sort(by_second, [](const pair<int, float>& p) {
+		return p.second;
+	});
+	for (size_t i = 1; i < by_second.size(); ++i) {
+		assert(by_second[i - 1].second <= by_second[i].second);
+	}
+
+	// negative keys through a projection, counting_sort and lsd_radix_sort are stable
+	vector<pair<int, int>> negative;
+	for (int i = 0; i < 5000; ++i) {
+		negative.push_back(pair<int, int>(i, rand() % 2000 - 1000));
+	}
+	const auto key = [](const pair<int, int>& p) {
+		return p.second;
+	};
+	const auto check = [](const vector<pair<int, int>>& res, bool stable) {
+		for (size_t i = 1; i < res.size(); ++i) {
+			assert(res[i - 1].second < res[i].second || (res[i - 1].second == res[i].second && (!stable || res[i - 1].first < res[i].first)));
+		}
+	};
+	auto by_key = negative;
+	counting_sort(by_key, key);
+	check(by_key, true);
+	by_key = negative;
+	counting_sort(by_key, -1000, 999, key);
+	check(by_key, true);
+	by_key = negative;
+	lsd_radix_sort(by_key, key);
+	check(by_key, true);
+	by_key = negative;
+	msd_radix_sort(by_key, key);
+	check(by_key, false);
+	by_key = negative;
+	msd_radix_sort_bin(by_key, key);
+	check(by_key, false);
+	// keys narrower than int, negative ones included
+	vector<int8_t> int8s;
+	vector<int16_t> int16s;
+	for (size_t i = 0; i < 3000; ++i) {
+		int8s.push_back(static_cast<int8_t>(rand() % 256 - 128));
+		int16s.push_back(static_cast<int16_t>(rand() % 2000 - 1000));
+	}
+	int16s[0] = std::numeric_limits<int16_t>::min();
+	int16s[1] = std::numeric_limits<int16_t>::max();
+	radix_sort_test(int8s);
+	radix_sort_test(int16s);
+	{
+		vector<int16_t> tiny;
+		tiny.push_back(5);
+		tiny.push_back(-3);
+		tiny.push_back(0);
+		counting_sort(tiny);
+		assert(tiny[0] == -3 && tiny[1] == 0 && tiny[2] == 5);
+	}
+	const int8_t int8_min = -128;
+	const int8_t int8_max = 127;
+	const int16_t int16_min = -1000;
+	const int16_t int16_max = 999;
+	auto counted8 = int8s;
+	counting_sort(counted8, int8_min, int8_max);
+	assert(check_sorted(counted8));
+	auto counted16 = int16s;
+	counting_sort(counted16);
+	assert(check_sorted(counted16));
+	counted16 = vector<int16_t>(int16s.view(2, int16s.size()));
+	counting_sort(counted16, int16_min, int16_max);
+	assert(check_sorted(counted16));
+
+	vector<int64_t> extremes(3000, 0);
+	for (size_t i = 0; i < extremes.size(); ++i) {
+		extremes[i] = i % 3 == 0 ? std::numeric_limits<int64_t>::min() + rand() : (i % 3 == 1 ? std::numeric_limits<int64_t>::max() - rand() : rand() - RAND_MAX / 2);
+	}
+	auto extremes_sorted = extremes;
+	std::sort(extremes_sorted.begin(), extremes_sorted.end());
+	msd_radix_sort(extremes);
+	assert(extremes == extremes_sorted);
+
+	// a view of 16 byte records on memory aligned to 8 bytes only, larger than
+	// radix_stream_bytes so full lines would be streamed
+	typedef pair<uint64_t, uint64_t> record;
+	const size_t records = radix_stream_bytes / sizeof(record) + 1000;
+	std::unique_ptr<uint64_t[]> mem(new uint64_t[2 * records + 1]);
+	auto * first = mem.get() + (reinterpret_cast<uintptr_t>(mem.get()) % 16 == 0 ? 1 : 0);
+	vector_view<record> unaligned(reinterpret_cast<record*>(first), records);
+	for (size_t i = 0; i < records; ++i) {
+		unaligned[i] = record(static_cast<uint64_t>(rand()) << 32 | rand(), i);
+	}
+	parallel_radix_sort(unaligned, 1);
+	for (size_t i = 1; i < records; ++i) {
+		assert(unaligned[i - 1].first < unaligned[i].first || (unaligned[i - 1].first == unaligned[i].first && unaligned[i - 1].second < unaligned[i].second));
+	}
+}
+
+template<typename K>
+static void argsort_test(const vector<K>& keys, const vector<uint32_t>& perm, bool stable) {
+	assert(perm.size() == keys.size());
+	vector<bool> seen(keys.size(), false);
+	for (size_t i = 0; i < perm.size(); ++i) {
+		assert(!seen[perm[i]]);
+		seen[perm[i]] = true;
+		if (i > 0) {
+			const auto& a = keys[perm[i - 1]];
+			const auto& b = keys[perm[i]];
+			assert(!(b < a) && (!stable || a < b || perm[i - 1] < perm[i]));
+		}
+	}
+}
+
+template<typename K>
+static void sort_by_key_test(const vector<K>& keys) {
+	argsort_test(keys, argsort(keys), false);
+	argsort_test(keys, stable_argsort(keys), true);
+	argsort_test(keys, radix_argsort(keys.view(), 3), true);
+
+	// the value of a key is its position, so stable orders are known
+	const auto perm = stable_argsort(keys);
+	vector<uint64_t> positions;
+	for (size_t i = 0; i < keys.size(); ++i) {
+		positions.push_back(i);
+	}
+	for (int variant = 0; variant < 3; ++variant) {
+		auto k = keys;
+		auto v = positions;
+		if (variant == 0) {
+			sort_by_key(k, v);
+		}
+		else if (variant == 1) {
+			stable_sort_by_key(k, v);
+		}
+		else {
+			radix_sort_by_key(k, v, 2);
+		}
+		for (size_t i = 0; i < k.size(); ++i) {
+			assert(k[i] == keys[v[i]]);
+			assert(i == 0 || !(k[i] < k[i - 1]));
+			assert(variant == 0 || v[i] == perm[i]);
+		}
+	}
+}
+
+static void sort_by_key_test() {
+	const size_t ns[] = {0, 1, 500, 3000, 200000};
+	for (auto n : ns) {
+		vector<uint32_t> few;
+		vector<uint64_t> big;
+		for (size_t i = 0; i < n; ++i) {
+			few.push_back(rand() % 100);
+			big.push_back(static_cast<uint64_t>(rand()) << 32 | rand());
+		}
+		sort_by_key_test(few);
+		sort_by_key_test(big);
+	}
+
+	vector<int> keys;
+	vector<vector<int>> values;
+	for (int i = 0; i < 100; ++i) {
+		keys.push_back(rand() % 10 - 5);
+		values.push_back(vector<int>(3, keys.back()));
+	}
+	stable_sort_by_key(keys, values);
+	for (size_t i = 0; i < keys.size(); ++i) {
+		assert(values[i].size() == 3 && values[i][0] == keys[i]);
+	}
+	assert(check_sorted(keys));
+}
+
+template<typename T>
+static void string_sort_test(const vector<T>& vec, const char * (*str)(const T&)) {
+	const auto check = [&](const vector<T>& res, const vector<size_t>& lcp) {
+		assert(res.size() == vec.size());
+		for (size_t i = 1; i < res.size(); ++i) {
+			const auto * a = str(res[i - 1]);
+			const auto * b = str(res[i]);
+			assert(strcmp(a, b) <= 0);
+			size_t l = 0;
+			while (a[l] != 0 && a[l] == b[l]) {
+				++l;
+			}
+			assert(lcp.empty() || lcp[i] == l);
+		}
+		assert(lcp.empty() || lcp[0] == 0);
+	};
+	auto res = vec;
+	vector<size_t> lcp;
+	multikey_quick_sort(res);
+	check(res, lcp);
+	res = vec;
+	multikey_quick_sort(res, lcp);
+	check(res, lcp);
+	res = vec;
+	msd_string_sort(res, lcp);
+	check(res, lcp);
+	lcp = vector<size_t>();
+	res = vec;
+	msd_string_sort(res);
+	check(res, lcp);
+}
+
+static void string_sort_test() {
+	// shared prefixes, duplicates, empty strings, prefixes of each other and chars above 127
+	const char * prefixes[] = {"", "http://", "http://www.example.com/", "\xff\x80"};
+	const size_t ns[] = {0, 1, 10, 100, 5000, 70000};
+	for (auto n : ns) {
+		vector<std::string> strings;
+		for (size_t i = 0; i < n; ++i) {
+			std::string s = prefixes[rand() % 4];
+			const auto len = rand() % 6;
+			for (int j = 0; j < len; ++j) {
+				s += static_cast<char>(j % 2 == 0 ? 'a' + rand() % 4 : rand() % 255 + 1);
+			}
+			strings.push_back(s);
+		}
+		string_sort_test<std::string>(strings, [](const std::string& s) {
+			return s.c_str();
+		});
+
+		vector<const char *> ptrs;
+		for (size_t i = 0; i < n; ++i) {
+			ptrs.push_back(strings[i].c_str());
+		}
+		string_sort_test<const char *>(ptrs, [](const char * const& s) {
+			return s;
+		});
+	}
+}
+
+static void block_merge_sort_test() {
+	// the value of a pair is its position, so stability can be checked
+	const size_t ns[] = {0, 1, 16, 17, 100, 1000, 4097, 65537};
+	for (auto n : ns) {
+		for (int mode = 0; mode < 4; ++mode) {
+			vector<pair<int, int>> vec;
+			for (size_t i = 0; i < n; ++i) {
+				const auto key = mode == 0 ? rand() : mode == 1 ? rand() % 3 : mode == 2 ? static_cast<int>(i) : static_cast<int>(n - i) / 7;
+				vec.push_back(pair<int, int>(key, static_cast<int>(i)));
+			}
+			block_merge_sort(vec);
+			for (size_t i = 1; i < vec.size(); ++i) {
+				assert(vec[i - 1].first < vec[i].first || (vec[i - 1].first == vec[i].first && vec[i - 1].second < vec[i].second));
+			}
+		}
+	}
+
+	vector<int> desc;
+	for (int i = 0; i < 5000; ++i) {
+		desc.push_back(rand() % 100);
+	}
+	block_merge_sort(desc, greater());
+	assert(check_sorted(desc, greater()));
+}
+
+static void sort_stats_test() {
+	vector<counted<int>> vec;
+	for (int i = 0; i < 1000; ++i) {
+		vec.push_back(counted<int>(rand()));
+	}
+
+	sort_stats stats;
+	{
+		auto tmp = vec;
+		sort_probe probe(stats);
+		quick_sort(tmp);
+		assert(check_sorted(tmp));
+	}
+	assert(stats.comparisons > 0 && stats.moves > 0);
+	assert(stats.depth == 0);
+#ifdef ALGO_SORT_STATS
+	assert(stats.max_depth > 0);
+#endif
+	assert(active_sort_stats() == nullptr);
+
+	{
+		auto tmp = vec;
+		sort_probe probe(stats);
+		merge_sort(tmp);
+	}
+	assert(stats.comparisons > 0 && stats.copies > 0);
+#ifdef ALGO_SORT_STATS
+	assert(stats.allocations > 0 && stats.allocated_bytes >= 1000 * sizeof(counted<int>));
+#else
+	assert(stats.allocations == 0 && stats.max_depth == 0);
+#endif
+
+	// nothing is counted without a probe
+	sort_stats outer;
+	{
+		auto tmp = vec;
+		sort_probe probe(outer);
+		{
+			sort_probe inner(stats);
+			heap_sort(tmp);
+		}
+		assert(outer.comparisons == 0 && active_sort_stats() == &outer);
+		insertion_sort(tmp);
+	}
+	assert(stats.comparisons > 0 && stats.max_depth == 0);
+	assert(outer.comparisons == 999);
+
+	sort_stats cmp_stats;
+	vector<int> ints(1000, 0);
+	for (auto& x : ints) {
+		x = rand();
+	}
+	insertion_sort(ints, make_counting_less(cmp_stats, less()));
+	assert(check_sorted(ints));
+	assert(cmp_stats.comparisons >= 999 && cmp_stats.moves == 0);
+}
+
+static void auto_sort_test() {
+	const auto check = [](vector<int> vec, sort_algorithm expected) {
+		auto correct = vec;
+		std::sort(correct.begin(), correct.end());
+		const auto plan = auto_sort(vec, 1);
+		assert(plan.algorithm == expected);
+		assert(plan.profile.size == vec.size());
+		assert(vec == correct);
+	};
+	const size_t n = 10000;
+	vector<int> small, sorted, reversed, few, random;
+	for (size_t i = 0; i < n; ++i) {
+		sorted.push_back(static_cast<int>(i) - 5000);
+		reversed.push_back(static_cast<int>(n - i) * 1000);
+		few.push_back(rand() % 100 - 50);
+		random.push_back(rand());
+	}
+	for (int i = 0; i < 20; ++i) {
+		small.push_back(rand());
+	}
+	check(vector<int>(), sort_algorithm::insertion);
+	check(small, sort_algorithm::insertion);
+	check(sorted, sort_algorithm::natural_merge);
+	check(reversed, sort_algorithm::natural_merge);
+	check(few, sort_algorithm::counting);
+	check(random, sort_algorithm::radix);
+	check(vector<int>(random.view(0, 1000)), sort_algorithm::simd_quick);
+
+	// keys narrower than int with negative values
+	vector<int16_t> narrow;
+	for (int i = 0; i < 100; ++i) {
+		narrow.push_back(static_cast<int16_t>(rand() % 21 - 10));
+	}
+	narrow[0] = -10;
+	narrow[1] = 10;
+	assert(auto_sort(narrow, 1).algorithm == sort_algorithm::counting);
+	assert(check_sorted(narrow));
+	vector<int8_t> bytes;
+	for (int i = 0; i < 1000; ++i) {
+		bytes.push_back(static_cast<int8_t>(rand() % 256 - 128));
+	}
+	assert(auto_sort(bytes, 1).algorithm == sort_algorithm::counting);
+	assert(check_sorted(bytes));
+
+	// a sample without the extremes must not lead to a counting sort that misses them
+	auto outliers = few;
+	outliers[1] = -1000000;
+	outliers[n - 2] = 1000000;
+	const auto plan = plan_sort(outliers.view(), 1);
+	assert(plan.algorithm != sort_algorithm::counting);
+	assert(plan.profile.range == 2000001);
+	run_sort_plan(outliers.view(), plan);
+	assert(check_sorted(outliers));
+
+	vector<std::string> strings;
+	for (size_t i = 0; i < 1000; ++i) {
+		strings.push_back(std::to_string(rand()));
+	}
+	auto copy = strings;
+	assert(auto_sort(copy, 1).algorithm == sort_algorithm::intro);
+	assert(check_sorted(copy));
+	vector<std::string> statuses;
+	for (size_t i = 0; i < 1000; ++i) {
+		statuses.push_back(std::to_string(200 + rand() % 5 * 100));
+	}
+	assert(auto_sort(statuses, 1).algorithm == sort_algorithm::three_way_quick);
+	assert(check_sorted(statuses));
+
+	auto_sort_limits limits;
+	limits.parallel = 100;
+	const auto parallel = auto_sort(strings, 4, limits);
+	assert(parallel.algorithm == sort_algorithm::parallel_sample && parallel.threads == 4);
+	assert(check_sorted(strings));
+	assert(strcmp(sort_algorithm_name(parallel.algorithm), "parallel_sample_sort") == 0);
+}
+
+static void three_way_quick_sort_test() {
+	const int keys[] = {1, 2, 3, 10, 100, 1 << 30};
+	const size_t ns[] = {0, 1, 17, 64, 1000, 100000};
+	for (auto k : keys) {
+		for (auto n : ns) {
+			vector<int> vec;
+			for (size_t i = 0; i < n; ++i) {
+				vec.push_back(rand() % k);
+			}
+			auto correct = vec;
+			std::sort(correct.begin(), correct.end());
+			three_way_quick_sort(vec);
+			assert(vec == correct);
+		}
+	}
+
+	// the equal elements are never looked at again, so k keys take about k levels
+	vector<int> two;
+	for (int i = 0; i < 100000; ++i) {
+		two.push_back(rand() % 2);
+	}
+	sort_stats stats;
+	{
+		sort_probe probe(stats);
+		three_way_quick_sort(two);
+	}
+	assert(check_sorted(two));
+#ifdef ALGO_SORT_STATS
+	assert(stats.max_depth >= 1 && stats.max_depth <= 2);
+#endif
+}
+
+template<typename T, typename Kernel>
+static void simd_sort_test(Kernel kernel) {
+	const size_t ns[] = {0, 1, 2, 7, 16, 17, 31, 32, 33, 100, 1000, 10000, 100000};
+	for (auto n : ns) {
+		for (int mode = 0; mode < 4; ++mode) {
+			vector<T> vec;
+			for (size_t i = 0; i < n; ++i) {
+				const auto r = (static_cast<int64_t>(rand()) - RAND_MAX / 2) * RAND_MAX + rand();
+				const auto x = mode == 0 ? r : (mode == 1 ? r % 3 : (mode == 2 ? static_cast<int64_t>(i) : static_cast<int64_t>(n - i)));
+				vec.push_back(static_cast<T>(x));
+			}
+			auto correct = vec;
+			std::sort(correct.begin(), correct.end());
+			simd_quick_sort(vec.view(), kernel);
+			assert(vec == correct);
+		}
+	}
+}
+
+template<typename T>
+static void simd_sort_test() {
+	simd_sort_test<T>(scalar_sort_kernel<T>());
+#ifdef __x86_64__
+	if (has_avx2()) {
+		simd_sort_test<T>(avx2_sort_kernel<T>());
+	}
+	if (has_avx512()) {
+		simd_sort_test<T>(avx512_sort_kernel<T>());
+	}
+#endif
+	vector<T> vec;
+	for (int i = 0; i < 1000; ++i) {
+		vec.push_back(static_cast<T>(rand() % 100));
+	}
+	simd_quick_sort(vec);
+	assert(check_sorted(vec));
+}
+
+static void simd_sort_test() {
+	simd_sort_test<int32_t>();
+	simd_sort_test<uint32_t>();
+	simd_sort_test<float>();
+	simd_sort_test<int64_t>();
+	simd_sort_test<double>();
+}
+
 void tests() {
 	// datastructures
 	vector_test();
@@ -530,6 +2014,10 @@ void tests() {
 	heap_test();
 	limited_heap_test();
 	search_tree_test();
+	btree_test();
+	hash_map_test();
+	concurrent_hash_map_test();
+	iterator_test();
 
 	// interfaces
 	stack_test();
@@ -538,7 +2026,21 @@ void tests() {
 
 	// algorithms
 	search_test();
+	static_search_test();
 	sort_test();
+	sort_order_test();
+	three_way_quick_sort_test();
+	select_test();
+	merge_test();
+	external_sort_test();
+	sample_sort_test();
+	radix_sort_test();
+	sort_by_key_test();
+	string_sort_test();
+	block_merge_sort_test();
+	sort_stats_test();
+	auto_sort_test();
+	simd_sort_test();
 }
 
 }
@@ -10,6 +10,8 @@ template<typename T>
 class vector {
 public:
 	using type = T;
+	using iterator = T*;
+	using const_iterator = const T*;
 
 	vector() = default;
 
@@ -28,10 +30,12 @@ public:
 	vector& operator=(const vector& v) {
 		drop();
 		cp(v);
+		return *this;
 	}
 
 	vector& operator=(vector&& v) {
 		mv(std::move(v));
+		return *this;
 	}
 
 	vector(size_t l, const T& val) : cap(l), len(l), arr(new T[cap]) {
@@ -40,7 +44,7 @@ public:
 		}
 	}
 
-	explicit vector(vector_view<T> v) : cap(v.get_vector().capacity()), len(v.size()), arr(new T[cap]) {
+	explicit vector(vector_view<const T> v) : cap(v.size()), len(v.size()), arr(new T[cap]) {
 		for (size_t i = 0; i < len; ++i) {
 			arr[i] = v[i];
 		}
@@ -60,6 +64,30 @@ public:
 		return len;
 	}
 
+	T * data() {
+		return arr;
+	}
+
+	const T * data() const {
+		return arr;
+	}
+
+	iterator begin() {
+		return arr;
+	}
+
+	iterator end() {
+		return arr + len;
+	}
+
+	const_iterator begin() const {
+		return arr;
+	}
+
+	const_iterator end() const {
+		return arr + len;
+	}
+
 	size_t capacity() const {
 		return cap;
 	}
@@ -70,6 +98,12 @@ public:
 		++len;
 	}
 
+	void push_back(T&& val) {
+		enlarge();
+		arr[len] = std::move(val);
+		++len;
+	}
+
 	const T& back() const {
 		assert(!empty());
 		return arr[len - 1];
@@ -140,11 +174,11 @@ public:
 		return view(from, size());
 	}
 
-	const vector_view<T> view(size_t from, size_t to) const {
-		return vector_view<T>(*this, from, to);
+	vector_view<const T> view(size_t from, size_t to) const {
+		return vector_view<const T>(*this, from, to);
 	}
 
-	const vector_view<T> view(size_t from = 0) const {
+	vector_view<const T> view(size_t from = 0) const {
 		return view(from, size());
 	}
 
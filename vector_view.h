@@ -1,5 +1,7 @@
 #pragma once
 
+#include <type_traits>
+
 #include "common.h"
 
 
@@ -8,55 +10,74 @@ namespace algo {
 template<typename T>
 class vector;
 
+/// a (pointer, length) window into contiguous memory: a vector, a raw array,
+/// an mmap'd file or another container's buffer. copying a view is copying
+/// two words, it never owns or copies the elements.
+/// vector_view<const T> is the read-only view, a mutable view converts to it
+/// but never the other way round.
 template<typename T>
 class vector_view {
 public:
-	vector_view() = delete;
+	using type = T;
+	using value_type = typename std::remove_const<T>::type;
+	using iterator = T*;
+
+	vector_view() = default;
 	vector_view(const vector_view&) = default;
 	vector_view(vector_view&&) = default;
 	~vector_view() = default;
-	vector_view& operator=(const vector_view& v) = delete;
-	vector_view& operator=(vector_view&& v) = delete;
+	vector_view& operator=(const vector_view& v) = default;
+	vector_view& operator=(vector_view&& v) = default;
+
+	vector_view(T * d, size_t l) : ptr(d), len(l) {}
 
-	vector_view(vector<T>& v, size_t f, size_t t) : vec(v), from(f), to(t) {
-		assert(from <= v.size());
-		assert(to <= v.size());
+	template<typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+	vector_view(const vector_view<U>& v) : ptr(v.data()), len(v.size()) {}
+
+	vector_view(vector<value_type>& v, size_t f, size_t t) : ptr(v.data() + f), len(t - f) {
+		assert(f <= t);
+		assert(t <= v.size());
 	}
 
-	vector_view(vector<T>& v, size_t f = 0) : vector_view(v, f, v.size()) {}
+	vector_view(vector<value_type>& v, size_t f = 0) : vector_view(v, f, v.size()) {}
 
-	vector_view(const vector<T>& v, size_t f, size_t t) : vec(const_cast<vector<T>&>(v)), from(f), to(t) {
-		assert(from <= v.size());
-		assert(to <= v.size());
+	template<typename U = T, typename = typename std::enable_if<std::is_const<U>::value>::type>
+	vector_view(const vector<value_type>& v, size_t f, size_t t) : ptr(v.data() + f), len(t - f) {
+		assert(f <= t);
+		assert(t <= v.size());
 	}
 
-	vector_view(const vector<T>& v, size_t f = 0) : vector_view(v, f, v.size()) {}
+	template<typename U = T, typename = typename std::enable_if<std::is_const<U>::value>::type>
+	vector_view(const vector<value_type>& v, size_t f = 0) : vector_view(v, f, v.size()) {}
 
 	size_t size() const {
-		return to - from;
+		return len;
 	}
 
-	const T& operator[](size_t n) const {
-		return vec[from + n];
+	T& operator[](size_t n) const {
+		assert(n < len);
+		return ptr[n];
 	}
 
-	T& operator[](size_t n) {
-		return vec[from + n];
+	T * data() const {
+		return ptr;
 	}
 
-	vector_view view(size_t f, size_t t) {
-		return vector_view(vec, from + f, from + t);
+	iterator begin() const {
+		return ptr;
 	}
 
-	vector_view view(size_t f = 0) {
-		return view(f, size());
+	iterator end() const {
+		return ptr + len;
 	}
 
-	const vector_view view(size_t f, size_t t) const {
-		return vector_view(vec, from + f, from + t);
+	vector_view view(size_t f, size_t t) const {
+		assert(f <= t);
+		assert(t <= len);
+		return vector_view(ptr + f, t - f);
 	}
 
-	const vector_view view(size_t f = 0) const {
+	vector_view view(size_t f = 0) const {
 		return view(f, size());
 	}
 
@@ -64,14 +85,18 @@ public:
 		return size() == 0;
 	}
 
-	const vector<T>& get_vector() const {
-		return vec;
-	}
-
 private:
-	vector<T>& vec;
-	size_t from{0};
-	size_t to{0};
+	T * ptr{nullptr};
+	size_t len{0};
 };
 
+/// the element type of a view without const, for arguments that should not take part in deduction
+template<typename T>
+using view_value_t = typename vector_view<T>::value_type;
+
+/// vector_view<const T> with T deduced from other arguments only,
+/// so mutable views and vectors convert to it
+template<typename T>
+using const_view_t = typename std::enable_if<true, vector_view<const T>>::type;
+
 }